@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../headers/search_generator.h"
+#include "../headers/search_server.h"
+
+// Query latency percentiles on an idle index and while a writer adds
+// WRITES_PER_SECOND documents; searches read a published version and never wait for it.
+namespace {
+	const int DOCUMENT_COUNT = 50000;
+	const int QUERY_COUNT = 200000;
+	const int WRITES_PER_SECOND = 1000;
+
+	void Measure(const char* name, const SearchServer& server, const std::vector<std::string>& queries) {
+		QueryContext context;
+		std::vector<double> latencies;
+		latencies.reserve(queries.size());
+		for (const std::string& query : queries) {
+			const auto start = std::chrono::steady_clock::now();
+			server.FindTopDocuments(context, query);
+			latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+		std::sort(latencies.begin(), latencies.end());
+		std::cout << name << ": p50 " << latencies[latencies.size() / 2] << " us, p99 " << latencies[latencies.size() * 99 / 100]
+			<< " us, max " << latencies.back() << " us" << std::endl;
+	}
+}
+
+int main() {
+	SearchGenerator generator;
+	const std::vector<std::string> dictionary = generator.GenerateDictionary(10000, 12);
+	std::vector<std::string> texts;
+	for (int i = 0; i < DOCUMENT_COUNT; ++i) {
+		texts.push_back(generator.GenerateQuery(dictionary, 50));
+	}
+	std::vector<DocumentInput> batch;
+	for (int i = 0; i < DOCUMENT_COUNT; ++i) {
+		batch.push_back({ i, texts[i], DocumentStatus::ACTUAL, { 1, 2, 3 } });
+	}
+	SearchServer server(std::string("and with"));
+	server.AddDocuments(batch);
+	const std::vector<std::string> queries = generator.GenerateQueries(dictionary, QUERY_COUNT, 5);
+	const std::vector<std::string> newTexts = generator.GenerateQueries(dictionary, WRITES_PER_SECOND * 60, 50);
+
+	Measure("no writes", server, queries);
+
+	std::atomic<bool> stop = false;
+	int written = 0;
+	std::thread writer([&] {
+		auto next = std::chrono::steady_clock::now();
+		while (!stop && written < static_cast<int>(newTexts.size())) {
+			server.AddDocument(DOCUMENT_COUNT + written, newTexts[written], DocumentStatus::ACTUAL, { 1 });
+			++written;
+			next += std::chrono::microseconds(1000000 / WRITES_PER_SECOND);
+			std::this_thread::sleep_until(next);
+		}
+	});
+	const auto start = std::chrono::steady_clock::now();
+	Measure("writes", server, queries);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	stop = true;
+	writer.join();
+	std::cout << "documents written: " << written << " (" << written / seconds << " per second), segments: "
+		<< server.GetIndexStatistics().segments << std::endl;
+	return 0;
+}
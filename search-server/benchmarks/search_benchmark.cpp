@@ -0,0 +1,341 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "../headers/corpus_ingestion.h"
+#include "../headers/metrics.h"
+#include "../headers/posting_list.h"
+#include "../headers/process_queries.h"
+#include "../headers/remove_duplicates.h"
+#include "../headers/score_accumulator.h"
+#include "../headers/search_generator.h"
+#include "../headers/search_server.h"
+
+// Times every public hot path on generated corpora and prints one JSON document.
+// Every corpus and query set comes from a fixed seed, so two runs of the same
+// build index and search the same text and their numbers can be compared.
+// Reference cases time earlier implementations of replaced hot paths next to
+// the current ones on the same input.
+// usage: search_benchmark [--max-documents N] [--queries N]
+namespace {
+	const std::vector<int> CORPUS_SIZES = { 10000, 100000, 1000000, 10000000 };
+	const int DEFAULT_MAX_DOCUMENTS = 100000;
+	const int DEFAULT_QUERY_COUNT = 1000;
+	// queries of one ProcessQueries batch, whatever --queries says
+	const int PROCESS_QUERIES_BATCH = 10000;
+	// the reference index keeps every posting of the corpus uncompressed, so larger
+	// corpora skip the cases that need it
+	const int REFERENCE_MAX_DOCUMENTS = 1000000;
+	// document indexes a cursor moves forward per Advance in posting_cursor_advance
+	const int ADVANCE_STRIDE = 64;
+	const int DICTIONARY_SIZE = 50000;
+	const int MAX_WORD_LENGTH = 10;
+	const int MAX_DOCUMENT_WORDS = 50;
+	// every DUPLICATE_INTERVAL-th document repeats the text of the one before it
+	const int DUPLICATE_INTERVAL = 100;
+	// and every REMOVE_INTERVAL-th document is removed one by one
+	const int REMOVE_INTERVAL = 100;
+	const uint32_t DICTIONARY_SEED = 1;
+	const uint32_t CORPUS_SEED = 2;
+	const uint32_t QUERY_SEED = 3;
+
+	struct Vocabulary {
+		const char* name;
+		double zipfExponent;
+	};
+	const std::vector<Vocabulary> VOCABULARIES = { { "uniform", 0.0 }, { "zipf", 1.0 } };
+	const std::vector<double> MINUS_PROBABILITIES = { 0.0, 0.2 };
+	const std::vector<int> QUERY_LENGTHS = { 3, 10 };
+
+	struct Case {
+		int documents;
+		const Vocabulary* vocabulary;
+		// negative for operations that do not run queries
+		double minusProbability;
+		int queryWords;
+	};
+
+	// results are summed here and printed, so the measured calls cannot be optimized away
+	std::size_t checksum = 0;
+	bool firstResult = true;
+
+	template <typename Operation>
+	void Measure(const Case& benchmarkCase, std::string_view name, std::size_t count, Operation operation) {
+		const auto start = std::chrono::steady_clock::now();
+		operation();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << (firstResult ? "\n" : ",\n") << "    { \"operation\": \"" << name << "\", \"documents\": " << benchmarkCase.documents
+			<< ", \"vocabulary\": \"" << benchmarkCase.vocabulary->name << "\"";
+		if (benchmarkCase.minusProbability >= 0) {
+			std::cout << ", \"minus_probability\": " << benchmarkCase.minusProbability << ", \"query_words\": " << benchmarkCase.queryWords;
+		}
+		std::cout << ", \"count\": " << count << ", \"seconds\": " << seconds << ", \"ns_per_operation\": " << (count > 0 ? seconds * 1e9 / count : 0.0)
+			<< ", \"operations_per_second\": " << (seconds > 0 ? count / seconds : 0.0) << " }";
+		std::cout.flush();
+		firstResult = false;
+	}
+
+	// increasing document indexes of every dictionary word, from the generated texts
+	using ReferenceIndex = std::vector<std::vector<int>>;
+
+	struct ReferenceQuery {
+		std::vector<int> plusWords;
+		std::vector<int> minusWords;
+	};
+
+	template <typename Callback>
+	void ForEachWord(std::string_view text, Callback callback) {
+		while (!text.empty()) {
+			const std::size_t space = text.find(' ');
+			callback(text.substr(0, space));
+			text.remove_prefix(space == std::string_view::npos ? text.size() : space + 1);
+		}
+	}
+
+	ReferenceIndex BuildReferenceIndex(const std::unordered_map<std::string_view, int>& wordIds, const std::vector<std::string>& texts) {
+		ReferenceIndex index(wordIds.size());
+		for (std::size_t documentIndex = 0; documentIndex < texts.size(); ++documentIndex) {
+			ForEachWord(texts[documentIndex], [&](std::string_view word) {
+				std::vector<int>& documents = index[wordIds.at(word)];
+				if (documents.empty() || documents.back() != static_cast<int>(documentIndex)) {
+					documents.push_back(static_cast<int>(documentIndex));
+				}
+			});
+		}
+		return index;
+	}
+
+	std::vector<ReferenceQuery> ParseReferenceQueries(const std::unordered_map<std::string_view, int>& wordIds, const std::vector<std::string>& queries) {
+		std::vector<ReferenceQuery> parsed(queries.size());
+		for (std::size_t i = 0; i < queries.size(); ++i) {
+			ForEachWord(queries[i], [&](std::string_view word) {
+				if (word.front() == '-') {
+					parsed[i].minusWords.push_back(wordIds.at(word.substr(1)));
+				}
+				else {
+					parsed[i].plusWords.push_back(wordIds.at(word));
+				}
+			});
+		}
+		return parsed;
+	}
+
+	double GetReferenceIdf(const ReferenceIndex& index, int word, int documentCount) {
+		return std::log(static_cast<double>(documentCount) / index[word].size());
+	}
+
+	// relevance summed in a tree, as FindAllDocuments did before the dense accumulator
+	std::size_t AccumulateInMap(const ReferenceIndex& index, const ReferenceQuery& query, int documentCount) {
+		std::map<int, double> scores;
+		for (int word : query.plusWords) {
+			if (!index[word].empty()) {
+				const double idf = GetReferenceIdf(index, word, documentCount);
+				for (int documentIndex : index[word]) {
+					scores[documentIndex] += idf;
+				}
+			}
+		}
+		for (int word : query.minusWords) {
+			for (int documentIndex : index[word]) {
+				scores.erase(documentIndex);
+			}
+		}
+		return scores.size();
+	}
+
+	std::size_t AccumulateDense(const ReferenceIndex& index, const ReferenceQuery& query, int documentCount, ScoreAccumulator& accumulator) {
+		accumulator.Reset(documentCount);
+		for (int word : query.plusWords) {
+			if (!index[word].empty()) {
+				const double idf = GetReferenceIdf(index, word, documentCount);
+				for (int documentIndex : index[word]) {
+					accumulator.Add(documentIndex, idf);
+				}
+			}
+		}
+		for (int word : query.minusWords) {
+			for (int documentIndex : index[word]) {
+				accumulator.Erase(documentIndex);
+			}
+		}
+		std::size_t matched = 0;
+		accumulator.ForEach([&](int, double) {
+			++matched;
+		});
+		return matched;
+	}
+
+	// ProcessQueries before the batch engine: one FindTopDocuments per query on the pool
+	std::vector<std::vector<Document>> ProcessQueriesPerQuery(const SearchServer& server, const std::vector<std::string>& queries) {
+		std::vector<std::vector<Document>> result(queries.size());
+		server.GetThreadPool().ParallelFor(queries.size(), [&](std::size_t i) {
+			result[i] = server.FindTopDocuments(queries[i]);
+		});
+		return result;
+	}
+
+	void RunCorpus(int documentCount, const Vocabulary& vocabulary, const std::vector<std::string>& dictionary, const std::unordered_map<std::string_view, int>& wordIds, int queryCount) {
+		SearchGenerator corpusGenerator(CORPUS_SEED);
+		corpusGenerator.SetZipfExponent(vocabulary.zipfExponent);
+		SearchServer server(std::string_view{});
+		const Case indexCase{ documentCount, &vocabulary, -1.0, 0 };
+
+		std::vector<std::string> texts(documentCount);
+		for (int id = 0; id < documentCount; ++id) {
+			texts[id] = id % DUPLICATE_INTERVAL == DUPLICATE_INTERVAL - 1 ? texts[id - 1] : corpusGenerator.GenerateQuery(dictionary, MAX_DOCUMENT_WORDS);
+		}
+		Measure(indexCase, "add_document", documentCount, [&] {
+			for (int id = 0; id < documentCount; ++id) {
+				server.AddDocument(id, texts[id], static_cast<DocumentStatus>(id % 3), { id % 10, 5 });
+			}
+		});
+
+		// the same documents loaded from a corpus file into a server of their own
+		const std::string corpusPath = (std::filesystem::temp_directory_path() / "search_benchmark_corpus.tsv").string();
+		{
+			const char* const STATUS_NAMES[] = { "ACTUAL", "IRRELEVANT", "BANNED" };
+			std::ofstream corpus(corpusPath, std::ios::binary);
+			for (int id = 0; id < documentCount; ++id) {
+				corpus << id << '\t' << STATUS_NAMES[id % 3] << '\t' << id % 10 << " 5\t" << texts[id] << '\n';
+			}
+		}
+		Measure(indexCase, "ingest_corpus_file", documentCount, [&] {
+			SearchServer ingested(std::string_view{});
+			checksum += IngestCorpusFile(ingested, corpusPath).documents;
+		});
+		std::filesystem::remove(corpusPath);
+		const ReferenceIndex referenceIndex = documentCount <= REFERENCE_MAX_DOCUMENTS ? BuildReferenceIndex(wordIds, texts) : ReferenceIndex();
+		texts.clear();
+		texts.shrink_to_fit();
+
+		if (!referenceIndex.empty()) {
+			// the corpus postings compressed, decoded in full and skipped through; both
+			// count every posting of the lists, so operations per second are postings per second
+			std::vector<PostingList> postingLists(referenceIndex.size());
+			std::size_t postingCount = 0;
+			for (std::size_t word = 0; word < referenceIndex.size(); ++word) {
+				for (int documentIndex : referenceIndex[word]) {
+					postingLists[word].Append(documentIndex, 1);
+				}
+				postingCount += referenceIndex[word].size();
+			}
+			Measure(indexCase, "posting_for_each", postingCount, [&] {
+				for (const PostingList& list : postingLists) {
+					list.ForEach([&](int documentIndex, uint32_t count) {
+						checksum += documentIndex + count;
+					});
+				}
+			});
+			Measure(indexCase, "posting_cursor_advance", postingCount, [&] {
+				for (const PostingList& list : postingLists) {
+					for (PostingList::Cursor cursor(list); cursor.GetDocumentIndex() != PostingList::Cursor::END; cursor.Advance(cursor.GetDocumentIndex() + ADVANCE_STRIDE)) {
+						checksum += cursor.GetCount();
+					}
+				}
+			});
+		}
+
+		for (double minusProbability : MINUS_PROBABILITIES) {
+			for (int queryWords : QUERY_LENGTHS) {
+				SearchGenerator queryGenerator(QUERY_SEED);
+				queryGenerator.SetZipfExponent(vocabulary.zipfExponent);
+				const std::vector<std::string> queries = queryGenerator.GenerateQueries(dictionary, queryCount, queryWords, minusProbability);
+				const Case queryCase{ documentCount, &vocabulary, minusProbability, queryWords };
+
+				Measure(queryCase, "find_top_documents_seq", queries.size(), [&] {
+					for (const std::string& query : queries) {
+						checksum += server.FindTopDocuments(std::execution::seq, query).size();
+					}
+				});
+				Measure(queryCase, "find_top_documents_par", queries.size(), [&] {
+					for (const std::string& query : queries) {
+						checksum += server.FindTopDocuments(std::execution::par, query).size();
+					}
+				});
+				Measure(queryCase, "match_document", queries.size(), [&] {
+					for (std::size_t i = 0; i < queries.size(); ++i) {
+						const int documentId = static_cast<int>(i * 7919 % documentCount);
+						checksum += std::get<0>(server.MatchDocument(queries[i], documentId)).size();
+					}
+				});
+				if (!referenceIndex.empty()) {
+					const std::vector<ReferenceQuery> referenceQueries = ParseReferenceQueries(wordIds, queries);
+					Measure(queryCase, "accumulate_map", referenceQueries.size(), [&] {
+						for (const ReferenceQuery& query : referenceQueries) {
+							checksum += AccumulateInMap(referenceIndex, query, documentCount);
+						}
+					});
+					Measure(queryCase, "accumulate_dense", referenceQueries.size(), [&] {
+						ScoreAccumulator& accumulator = ScoreAccumulator::ForCurrentThread();
+						for (const ReferenceQuery& query : referenceQueries) {
+							checksum += AccumulateDense(referenceIndex, query, documentCount, accumulator);
+						}
+					});
+				}
+
+				const std::vector<std::string> batch = queryGenerator.GenerateQueries(dictionary, PROCESS_QUERIES_BATCH, queryWords, minusProbability);
+				Measure(queryCase, "process_queries_per_query", batch.size(), [&] {
+					for (const std::vector<Document>& documents : ProcessQueriesPerQuery(server, batch)) {
+						checksum += documents.size();
+					}
+				});
+				Measure(queryCase, "process_queries", batch.size(), [&] {
+					checksum += ProcessQueriesJoined(server, batch).size();
+				});
+			}
+		}
+
+		Measure(indexCase, "remove_document", documentCount / REMOVE_INTERVAL, [&] {
+			for (int id = REMOVE_INTERVAL / 2; id < documentCount; id += REMOVE_INTERVAL) {
+				server.RemoveDocument(id);
+			}
+		});
+		Measure(indexCase, "remove_duplicates", server.GetDocumentCount(), [&] {
+			checksum += RemoveDuplicates(server).size();
+		});
+	}
+
+	int ReadOption(int argc, char** argv, std::string_view name, int defaultValue) {
+		for (int i = 1; i + 1 < argc; ++i) {
+			if (argv[i] == name) {
+				return std::atoi(argv[i + 1]);
+			}
+		}
+		return defaultValue;
+	}
+}
+
+int main(int argc, char** argv) {
+	const int maxDocuments = ReadOption(argc, argv, "--max-documents", DEFAULT_MAX_DOCUMENTS);
+	const int queryCount = ReadOption(argc, argv, "--queries", DEFAULT_QUERY_COUNT);
+	SearchGenerator dictionaryGenerator(DICTIONARY_SEED);
+	const std::vector<std::string> dictionary = dictionaryGenerator.GenerateDictionary(DICTIONARY_SIZE, MAX_WORD_LENGTH);
+	std::unordered_map<std::string_view, int> wordIds;
+	for (std::size_t i = 0; i < dictionary.size(); ++i) {
+		wordIds.emplace(dictionary[i], static_cast<int>(i));
+	}
+
+	std::cout << "{\n  \"threads\": " << SearchServer().GetThreadPool().GetThreadCount() << ",\n  \"dictionary_words\": " << dictionary.size()
+		<< ",\n  \"results\": [";
+	for (int documentCount : CORPUS_SIZES) {
+		if (documentCount > maxDocuments) {
+			break;
+		}
+		for (const Vocabulary& vocabulary : VOCABULARIES) {
+			RunCorpus(documentCount, vocabulary, dictionary, wordIds, queryCount);
+		}
+	}
+	std::cout << "\n  ],\n  \"metrics\": " << Metrics::GetSnapshot().ToJson() << ",\n  \"checksum\": " << checksum << "\n}" << std::endl;
+	return 0;
+}
@@ -0,0 +1,360 @@
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "headers/corpus_ingestion.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// a streamed input is read in chunks of at least this size, cut after their last line break
+	const std::size_t STREAM_CHUNK_BYTES = std::size_t{ 16 } << 20;
+	const char FIELD_SEPARATOR = '\t';
+
+	template <typename T>
+	class BoundedQueue {
+	public:
+		explicit BoundedQueue(std::size_t capacity) :capacity(capacity) {}
+
+		// blocks while the queue is full; false once it was cancelled
+		bool Push(T value) {
+			std::unique_lock<std::mutex> lock(mutex);
+			notFull.wait(lock, [&] { return items.size() < capacity || cancelled; });
+			if (cancelled) {
+				return false;
+			}
+			items.push_back(std::move(value));
+			notEmpty.notify_one();
+			return true;
+		}
+
+		// blocks while the queue is empty; nothing once it is closed and drained or cancelled
+		std::optional<T> Pop() {
+			std::unique_lock<std::mutex> lock(mutex);
+			notEmpty.wait(lock, [&] { return !items.empty() || closed || cancelled; });
+			if (cancelled || items.empty()) {
+				return std::nullopt;
+			}
+			std::optional<T> value(std::move(items.front()));
+			items.pop_front();
+			notFull.notify_one();
+			return value;
+		}
+
+		// no more pushes, the items already queued are still popped
+		void Close() {
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			notEmpty.notify_all();
+		}
+
+		// drops the queued items and wakes every waiting thread
+		void Cancel() {
+			std::lock_guard<std::mutex> lock(mutex);
+			cancelled = true;
+			items.clear();
+			notEmpty.notify_all();
+			notFull.notify_all();
+		}
+	private:
+		std::size_t capacity;
+		std::mutex mutex;
+		std::condition_variable notFull;
+		std::condition_variable notEmpty;
+		std::deque<T> items;
+		bool closed = false;
+		bool cancelled = false;
+	};
+
+	struct ParsedBatch {
+		// owns the bytes the document texts point into
+		std::shared_ptr<const void> storage;
+		std::vector<DocumentInput> documents;
+		std::size_t bytes = 0;
+	};
+
+	struct IndexedBatch {
+		PreparedDocuments prepared;
+		std::size_t bytes = 0;
+	};
+
+	// read-only mapping of a whole file; empty where mapping is not available
+	class MappedFile {
+	public:
+		explicit MappedFile(const std::string& path) {
+#ifndef _WIN32
+			const int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("cannot open corpus file " + path);
+			}
+			struct stat fileStat;
+			if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+				void* mapping = mmap(nullptr, static_cast<std::size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+				if (mapping != MAP_FAILED) {
+					data = static_cast<const char*>(mapping);
+					size = static_cast<std::size_t>(fileStat.st_size);
+					// one front-to-back pass: read ahead aggressively
+					madvise(mapping, size, MADV_SEQUENTIAL);
+				}
+			}
+			close(fd);
+#endif
+		}
+
+		~MappedFile() {
+#ifndef _WIN32
+			if (data != nullptr) {
+				munmap(const_cast<char*>(data), size);
+			}
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool IsMapped()const {
+			return data != nullptr;
+		}
+
+		std::string_view GetText()const {
+			return { data, size };
+		}
+	private:
+		const char* data = nullptr;
+		std::size_t size = 0;
+	};
+
+	[[noreturn]] void ThrowLineError(std::size_t lineNumber, const char* message) {
+		throw std::invalid_argument("corpus line " + std::to_string(lineNumber) + ": " + message);
+	}
+
+	std::string_view NextField(std::string_view& line) {
+		const std::size_t separator = line.find(FIELD_SEPARATOR);
+		const std::string_view field = line.substr(0, separator);
+		line.remove_prefix(separator == std::string_view::npos ? line.size() : separator + 1);
+		return field;
+	}
+
+	bool ParseInt(std::string_view text, int& value) {
+		const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+		return error == std::errc() && end == text.data() + text.size();
+	}
+
+	bool ParseStatus(std::string_view text, DocumentStatus& status) {
+		static const std::string_view NAMES[] = { "ACTUAL", "IRRELEVANT", "BANNED", "REMOVED" };
+		for (std::size_t i = 0; i < std::size(NAMES); ++i) {
+			if (text == NAMES[i]) {
+				status = static_cast<DocumentStatus>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	DocumentInput ParseLine(std::string_view line, std::size_t lineNumber) {
+		DocumentInput document;
+		if (!ParseInt(NextField(line), document.id)) {
+			ThrowLineError(lineNumber, "document id is not a number");
+		}
+		if (!ParseStatus(NextField(line), document.status)) {
+			ThrowLineError(lineNumber, "document status is invalid");
+		}
+		std::string_view ratings = NextField(line);
+		while (!ratings.empty()) {
+			const std::size_t space = ratings.find(' ');
+			const std::string_view rating = ratings.substr(0, space);
+			ratings.remove_prefix(space == std::string_view::npos ? ratings.size() : space + 1);
+			if (rating.empty()) {
+				continue;
+			}
+			int value = 0;
+			if (!ParseInt(rating, value)) {
+				ThrowLineError(lineNumber, "rating is not a number");
+			}
+			document.ratings.push_back(value);
+		}
+		// the text is the rest of the line, tabs included
+		document.text = line;
+		return document;
+	}
+
+	// splits text, whole lines kept alive by storage, into batches; false once emit refused one
+	template <typename Emit>
+	bool ParseLines(std::shared_ptr<const void> storage, std::string_view text, std::size_t batchDocuments, std::size_t& lineNumber, Emit emit) {
+		ParsedBatch batch{ storage, {}, 0 };
+		while (!text.empty()) {
+			const std::size_t lineEnd = text.find('\n');
+			const std::size_t consumed = lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+			std::string_view line = text.substr(0, lineEnd);
+			text.remove_prefix(consumed);
+			++lineNumber;
+			if (!line.empty() && line.back() == '\r') {
+				line.remove_suffix(1);
+			}
+			batch.bytes += consumed;
+			if (!line.empty()) {
+				batch.documents.push_back(ParseLine(line, lineNumber));
+			}
+			if (batch.documents.size() == batchDocuments) {
+				if (!emit(std::move(batch))) {
+					return false;
+				}
+				batch = ParsedBatch{ storage, {}, 0 };
+			}
+		}
+		return batch.bytes == 0 || emit(std::move(batch));
+	}
+
+	template <typename Emit>
+	void StreamLines(std::istream& input, std::size_t batchDocuments, Emit emit) {
+		std::size_t lineNumber = 0;
+		std::string carry;
+		while (true) {
+			auto chunk = std::make_shared<std::string>(std::move(carry));
+			carry.clear();
+			const std::size_t kept = chunk->size();
+			chunk->resize(kept + STREAM_CHUNK_BYTES);
+			input.read(chunk->data() + kept, static_cast<std::streamsize>(STREAM_CHUNK_BYTES));
+			if (input.bad()) {
+				throw std::runtime_error("cannot read corpus");
+			}
+			chunk->resize(kept + static_cast<std::size_t>(input.gcount()));
+			const bool finished = input.eof();
+			if (!finished) {
+				// the unfinished last line moves on to the next chunk
+				const std::size_t lastBreak = chunk->rfind('\n');
+				const std::size_t cut = lastBreak == std::string::npos ? 0 : lastBreak + 1;
+				carry.assign(*chunk, cut, std::string::npos);
+				chunk->resize(cut);
+			}
+			if (!chunk->empty() && !ParseLines(chunk, *chunk, batchDocuments, lineNumber, emit)) {
+				return;
+			}
+			if (finished) {
+				return;
+			}
+		}
+	}
+
+	// runs produce(emit) on a reader thread and prepares and commits what it emits
+	template <typename Produce>
+	IndexingStatistics RunPipeline(SearchServer& server, std::size_t totalBytes, const IngestionOptions& options, Produce produce) {
+		if (options.batchDocuments == 0 || options.queueCapacity == 0) {
+			throw std::invalid_argument("ingestion batches and queues must not be empty");
+		}
+		const auto startTime = std::chrono::steady_clock::now();
+		BoundedQueue<ParsedBatch> parsed(options.queueCapacity);
+		BoundedQueue<IndexedBatch> indexed(options.queueCapacity);
+		std::mutex errorMutex;
+		std::exception_ptr error;
+		const auto fail = [&](std::exception_ptr exception) {
+			{
+				std::lock_guard<std::mutex> lock(errorMutex);
+				if (!error) {
+					error = exception;
+				}
+			}
+			parsed.Cancel();
+			indexed.Cancel();
+		};
+
+		// the stages block on their queues for the whole run, so they get threads of their
+		// own rather than pool workers; tokenizing still fans out over the server's pool
+		std::thread reader([&] {
+			try {
+				produce([&](ParsedBatch batch) {
+					return parsed.Push(std::move(batch));
+				});
+				parsed.Close();
+			}
+			catch (...) {
+				fail(std::current_exception());
+			}
+		});
+		std::thread preparer([&] {
+			try {
+				while (std::optional<ParsedBatch> batch = parsed.Pop()) {
+					IndexedBatch prepared{ server.PrepareDocuments(batch->documents), batch->bytes };
+					// the segment holds copies of the words, the input can go
+					batch.reset();
+					if (!indexed.Push(std::move(prepared))) {
+						return;
+					}
+				}
+				indexed.Close();
+			}
+			catch (...) {
+				fail(std::current_exception());
+			}
+		});
+
+		IngestionProgress progress;
+		progress.totalBytes = totalBytes;
+		try {
+			while (std::optional<IndexedBatch> batch = indexed.Pop()) {
+				server.CommitDocuments(batch->prepared);
+				progress.documents += batch->prepared.documents;
+				progress.bytes += batch->bytes;
+				progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+				if (options.progress) {
+					options.progress(progress);
+				}
+			}
+		}
+		catch (...) {
+			fail(std::current_exception());
+		}
+		reader.join();
+		preparer.join();
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		IndexingStatistics statistics = progress;
+		statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		return statistics;
+	}
+}
+
+IndexingStatistics IngestCorpusFile(SearchServer& server, const std::string& path, const IngestionOptions& options) {
+	auto file = std::make_shared<MappedFile>(path);
+	if (file->IsMapped()) {
+		const std::string_view text = file->GetText();
+		return RunPipeline(server, text.size(), options, [&](auto emit) {
+			std::size_t lineNumber = 0;
+			ParseLines(file, text, options.batchDocuments, lineNumber, emit);
+		});
+	}
+	std::ifstream input(path, std::ios::binary);
+	if (!input) {
+		throw std::runtime_error("cannot open corpus file " + path);
+	}
+	// pipes and other special files have no size
+	std::error_code sizeError;
+	const std::uintmax_t fileSize = std::filesystem::file_size(path, sizeError);
+	const std::size_t totalBytes = sizeError ? 0 : static_cast<std::size_t>(fileSize);
+	return RunPipeline(server, totalBytes, options, [&](auto emit) {
+		StreamLines(input, options.batchDocuments, emit);
+	});
+}
+
+IndexingStatistics IngestCorpus(SearchServer& server, std::istream& input, const IngestionOptions& options) {
+	return RunPipeline(server, 0, options, [&](auto emit) {
+		StreamLines(input, options.batchDocuments, emit);
+	});
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+
+#include "indexing.h"
+#include "search_server.h"
+
+struct IngestionProgress : IndexingStatistics {
+	// size of the input, 0 for a stream of unknown length
+	std::size_t totalBytes = 0;
+};
+
+struct IngestionOptions {
+	// documents per batch; every batch becomes one segment
+	std::size_t batchDocuments = 16384;
+	// batches waiting between two stages; a full queue holds back the stage before it
+	std::size_t queueCapacity = 2;
+	// called by the ingesting thread after every published batch
+	std::function<void(const IngestionProgress&)> progress;
+};
+
+// Loads a corpus with one document per line: id, status name (ACTUAL, IRRELEVANT,
+// BANNED or REMOVED), space separated ratings and text, separated by tabs.
+// Three threads form a pipeline joined by bounded queues: the reader splits the
+// input into batches of documents whose texts point into the input buffer, the
+// next one tokenizes them with SearchServer::PrepareDocuments and the calling
+// thread publishes them with CommitDocuments. A file is memory-mapped where the
+// platform allows and streamed in chunks otherwise.
+// Statistics and progress count input bytes, line breaks and fields included.
+// Throws std::invalid_argument naming the line for malformed lines or documents and
+// std::runtime_error when the input cannot be read; batches published before stay indexed.
+IndexingStatistics IngestCorpusFile(SearchServer& server, const std::string& path, const IngestionOptions& options = {});
+IndexingStatistics IngestCorpus(SearchServer& server, std::istream& input, const IngestionOptions& options = {});
@@ -0,0 +1,36 @@
+#pragma once
+#include <type_traits>
+
+#include "document.h"
+#include "index_segment.h"
+
+// Filters recognized at compile time. A status filter is answered from the status
+// bitsets of a segment and accept-all only from its tombstones, so neither costs a
+// call per posting; any other predicate is called with (id, status, rating).
+struct StatusFilter {
+	DocumentStatus status;
+
+	bool operator()(int, DocumentStatus documentStatus, int)const {
+		return documentStatus == status;
+	}
+};
+
+struct AcceptAllFilter {
+	bool operator()(int, DocumentStatus, int)const {
+		return true;
+	}
+};
+
+// true when the document has not been removed and passes the filter
+template <typename Predicat>
+bool AcceptsDocument(const IndexSegment& segment, int documentIndex, const Predicat& filter) {
+	if constexpr (std::is_same_v<Predicat, StatusFilter>) {
+		return segment.HasStatus(documentIndex, filter.status);
+	}
+	else if constexpr (std::is_same_v<Predicat, AcceptAllFilter>) {
+		return !segment.IsRemoved(documentIndex);
+	}
+	else {
+		return !segment.IsRemoved(documentIndex) && filter(segment.GetDocumentId(documentIndex), segment.GetStatus(documentIndex), segment.GetRating(documentIndex));
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "indexing.h"
+#include "search_server.h"
+
+// Accumulates documents and hands them to SearchServer::AddDocuments in one batch.
+class IndexBuilder {
+public:
+	explicit IndexBuilder(SearchServer& searchServer);
+
+	IndexBuilder& Add(int documentId, std::string document, DocumentStatus status, std::vector<int> ratings);
+	std::size_t GetPendingCount()const;
+	// indexes everything added so far; the builder is empty afterwards, or unchanged
+	// when AddDocuments throws
+	IndexingStatistics Build();
+private:
+	struct PendingDocument {
+		int id;
+		std::string text;
+		DocumentStatus status;
+		std::vector<int> ratings;
+	};
+	SearchServer& search;
+	std::vector<PendingDocument> pending;
+};
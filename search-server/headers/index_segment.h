@@ -0,0 +1,167 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "posting_list.h"
+#include "term_dictionary.h"
+#include "word_frequencies.h"
+
+// Slice of the index with its own term dictionary; its documents have internal
+// indexes [0, GetSize()) in insertion order, which is the order of its postings.
+// A segment is filled through the Add methods and never changes once it is shared:
+// removals and merges build new segments, so readers holding the old one are unaffected.
+// A removal only marks the document in a tombstone bitset that scoring consults;
+// its postings and per-document state are freed when the segment is merged.
+class IndexSegment {
+public:
+	static constexpr int NOT_FOUND = -1;
+	static constexpr std::size_t STATUS_COUNT = static_cast<std::size_t>(DocumentStatus::REMOVED) + 1;
+
+	struct Statistics {
+		std::size_t segments;
+		std::size_t terms;
+		// postings of removed documents included
+		std::size_t postings;
+		std::size_t postingBytes;
+		// removed documents still held by the segments
+		std::size_t removedDocuments;
+		// approximate heap bytes of postings, dictionaries and per-document state
+		std::size_t memoryBytes;
+
+		double GetBytesPerPosting()const;
+	};
+
+	// appends a document slot and returns its internal index; its postings are added afterwards
+	int AddDocument(int documentId, int rating, DocumentStatus status, uint32_t length);
+	// postings of a term must be added in increasing document index order
+	void AddPosting(std::string_view term, int documentIndex, uint32_t count);
+	void AddPostings(std::string_view term, const std::vector<Posting>& list);
+	// takes over a whole list, used when restoring a snapshot
+	void AddPostings(std::string_view term, PostingList list);
+	// builds the forward index from the postings; called once they are all added,
+	// before the segment is shared
+	void Seal();
+	// forward index and max term frequencies in their in-memory layout, as snapshots store them
+	struct ForwardIndex {
+		std::string_view offsets;
+		std::string_view entries;
+		std::string_view maxTermFrequencies;
+	};
+	ForwardIndex GetForwardIndex()const;
+	// seals with a forward index written by GetForwardIndex instead of decoding the postings;
+	// it is read in place from memory that storage keeps alive, only its sizes are checked
+	void Seal(const ForwardIndex& forwardIndex, std::shared_ptr<const void> storage);
+	// used when restoring a snapshot, after Seal
+	void MarkRemoved(int documentIndex);
+
+	// copy with the document marked removed; everything but the tombstones is shared with this segment
+	std::shared_ptr<IndexSegment> RemoveDocument(int documentIndex)const;
+	// one segment holding the documents of the given segments in their order;
+	// removed documents are dropped and the others renumbered
+	static std::shared_ptr<IndexSegment> Merge(const std::vector<std::shared_ptr<const IndexSegment>>& segments);
+	// true when one of the segments was derived from the other by removals
+	bool IsVersionOf(const IndexSegment& other)const;
+
+	// documents, removed ones included
+	int GetSize()const;
+	// documents that have not been removed
+	std::size_t GetDocumentCount()const;
+	std::size_t GetRemovedCount()const;
+	// internal index of the document, removed ones included, or NOT_FOUND
+	int FindDocument(int documentId)const;
+	bool IsRemoved(int documentIndex)const;
+	// the document has the status and has not been removed
+	bool HasStatus(int documentIndex, DocumentStatus status)const;
+	int GetDocumentId(int documentIndex)const;
+	int GetRating(int documentIndex)const;
+	DocumentStatus GetStatus(int documentIndex)const;
+	uint32_t GetLength(int documentIndex)const;
+	double GetInverseLength(int documentIndex)const;
+	WordFrequencies GetWordFrequencies(int documentIndex)const;
+
+	std::size_t GetTermCount()const;
+	std::string_view GetTerm(int termId)const;
+	// term id of the word or NOT_FOUND
+	int FindTerm(std::string_view term)const;
+	const PostingList& GetPostings(int termId)const;
+	// largest tf of the term over the documents of the segment, removed ones included;
+	// times the idf it bounds the score any document can get from the term
+	double GetMaxTermFrequency(int termId)const;
+	// nullptr when no document of the segment ever had the term; the list
+	// still holds removed documents, which IsRemoved tells apart
+	const PostingList* FindPostings(std::string_view term)const;
+	// documents having the term that have not been removed
+	std::size_t GetDocumentFrequency(std::string_view term)const;
+	Statistics GetStatistics()const;
+	std::size_t GetMemoryUsage()const;
+private:
+	// everything a removal leaves untouched, shared by a segment and its copies
+	struct Content {
+		TermDictionary dictionary;
+		std::vector<int> ids;
+		std::vector<int> ratings;
+		std::vector<DocumentStatus> statuses;
+		// a bitset of the documents per status, combined with the tombstones by status filters
+		std::array<std::vector<uint64_t>, STATUS_COUNT> statusBits;
+		std::vector<uint32_t> lengths;
+		std::vector<double> inverseLengths;
+		// forward index: the entries of document i are [forwardOffsets[i], forwardOffsets[i + 1])
+		std::vector<uint32_t> forwardOffsets;
+		std::vector<ForwardEntry> forwardEntries;
+		std::vector<double> maxTermFrequencies;
+		// what readers use once the segment is sealed: the vectors above, or a snapshot
+		// that forwardStorage keeps mapped
+		const uint32_t* forwardOffsetData = nullptr;
+		const ForwardEntry* forwardEntryData = nullptr;
+		const double* maxTermFrequencyData = nullptr;
+		std::shared_ptr<const void> forwardStorage;
+		std::unordered_map<int, int> indexes;
+	};
+	// copied on every removal, so it holds nothing proportional to the postings
+	struct Tombstones {
+		std::vector<uint64_t> bits;
+		// postings of removed documents per term id, sized lazily
+		std::vector<uint32_t> postings;
+		std::size_t count = 0;
+	};
+	std::shared_ptr<Content> content = std::make_shared<Content>();
+	// one list per term id, shared by the copies removals make
+	std::vector<std::shared_ptr<PostingList>> postings;
+	std::shared_ptr<Tombstones> tombstones = std::make_shared<Tombstones>();
+
+	int AddTerm(std::string_view term);
+	void MarkRemoved(Tombstones& target, int documentIndex)const;
+};
+
+// the accessors below run for every scored posting
+
+inline bool IndexSegment::IsRemoved(int documentIndex)const {
+	return (tombstones->bits[documentIndex >> 6] >> (documentIndex & 63) & 1) != 0;
+}
+
+inline bool IndexSegment::HasStatus(int documentIndex, DocumentStatus status)const {
+	const std::size_t word = documentIndex >> 6;
+	return (content->statusBits[static_cast<std::size_t>(status)][word] & ~tombstones->bits[word]) >> (documentIndex & 63) & 1;
+}
+
+inline int IndexSegment::GetDocumentId(int documentIndex)const {
+	return content->ids[documentIndex];
+}
+
+inline int IndexSegment::GetRating(int documentIndex)const {
+	return content->ratings[documentIndex];
+}
+
+inline DocumentStatus IndexSegment::GetStatus(int documentIndex)const {
+	return content->statuses[documentIndex];
+}
+
+inline double IndexSegment::GetInverseLength(int documentIndex)const {
+	return content->inverseLengths[documentIndex];
+}
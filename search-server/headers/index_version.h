@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "index_segment.h"
+#include "term_statistics.h"
+
+// One published state of the index: its segments in internal index order.
+// A version never changes, readers keep the one they started with for a whole
+// query while writers build and publish the next one.
+class IndexVersion {
+public:
+	IndexVersion(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics, uint64_t generation);
+
+	const std::vector<std::shared_ptr<const IndexSegment>>& GetSegments()const;
+	// grows with every change of the documents; merges and compaction keep it, as they
+	// change no result. Cached results and pagination cursors carry it
+	uint64_t GetGeneration()const;
+	std::size_t GetDocumentCount()const;
+	// documents of all segments, removed ones included
+	std::size_t GetSize()const;
+	// segment holding the document unless it has been removed, or nullptr
+	const IndexSegment* FindDocument(int documentId, int& documentIndex)const;
+	// documents of all segments having the term, removed ones excluded
+	std::size_t GetDocumentFrequency(std::string_view term)const;
+	// idf over all segments, 0 for words no document has
+	double GetIdf(std::string_view term)const;
+	// kept up to date by the writers, which derive the next table from this one
+	const std::shared_ptr<const TermStatistics>& GetTermStatistics()const;
+	// ids of the documents that have not been removed, in increasing order; built on first use
+	const std::vector<int>& GetDocumentIds()const;
+	// empty for unknown and removed ids
+	WordFrequencies GetWordFrequencies(int documentId)const;
+	IndexSegment::Statistics GetStatistics()const;
+private:
+	std::vector<std::shared_ptr<const IndexSegment>> segments;
+	std::shared_ptr<const TermStatistics> termStatistics;
+	uint64_t generation;
+	std::size_t documentCount = 0;
+	double logDocumentCount = 0.0;
+	mutable std::once_flag documentIdsBuilt;
+	mutable std::vector<int> documentIds;
+};
+
+// Ids of the documents of one version. The range and each of its iterators share
+// ownership of the version, so they stay valid while writers and background merges
+// publish newer ones, and all of an iteration sees the same documents.
+class DocumentIdRange {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = int;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const int*;
+		using reference = const int&;
+
+		// the end of every range
+		Iterator() = default;
+		Iterator(std::shared_ptr<const IndexVersion> version, std::size_t position);
+		const int& operator*()const;
+		Iterator& operator++();
+		Iterator operator++(int);
+		bool operator==(const Iterator& other)const;
+		bool operator!=(const Iterator& other)const;
+	private:
+		std::shared_ptr<const IndexVersion> version;
+		const std::vector<int>* ids = nullptr;
+		std::size_t position = 0;
+
+		bool IsEnd()const;
+	};
+
+	explicit DocumentIdRange(std::shared_ptr<const IndexVersion> version);
+
+	Iterator begin()const;
+	Iterator end()const;
+	std::size_t size()const;
+	// the pinned version, for reading more of it than the ids
+	const IndexVersion& GetVersion()const;
+private:
+	std::shared_ptr<const IndexVersion> version;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// One document of a bulk AddDocuments call; the text only has to outlive the call.
+struct DocumentInput {
+	int id;
+	std::string_view text;
+	DocumentStatus status;
+	std::vector<int> ratings;
+};
+
+class IndexSegment;
+
+// A batch tokenized into its own segment by SearchServer::PrepareDocuments,
+// invisible to searches until CommitDocuments publishes it.
+struct PreparedDocuments {
+	std::shared_ptr<const IndexSegment> segment;
+	std::size_t documents = 0;
+	std::size_t bytes = 0;
+};
+
+struct IndexingStatistics {
+	std::size_t documents = 0;
+	std::size_t bytes = 0;
+	double seconds = 0.0;
+
+	double GetDocumentsPerSecond()const;
+	double GetMegabytesPerSecond()const;
+};
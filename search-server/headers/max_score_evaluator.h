@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "document_filter.h"
+#include "index_segment.h"
+#include "posting_list.h"
+#include "query_context.h"
+#include "top_documents.h"
+
+// Document-at-a-time scoring with MaxScore pruning. The plus terms are ordered by
+// their upper bound, idf times the largest tf in the segment. The weakest terms whose
+// bounds together cannot lift a document into the current top are non-essential: only
+// documents of the other terms are visited, and the non-essential lists are probed
+// through their skip entries for the documents that can still make it. Minus words
+// are checked before that. Scores are summed in query term order, so every document
+// gets exactly the relevance term-at-a-time scoring gives it.
+class MaxScoreEvaluator {
+public:
+	// evaluator owned by the calling thread, reused across queries
+	static MaxScoreEvaluator& ForCurrentThread();
+
+	template <typename Predicat>
+	void Score(const IndexSegment& segment, const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings, Predicat filter, TopDocuments& matched_documents);
+private:
+	// per plus term in query order
+	std::vector<PostingList::Cursor> cursors;
+	std::vector<double> bounds;
+	std::vector<double> contributions;
+	std::vector<char> matched;
+	std::vector<PostingList::Cursor> minusCursors;
+	// query term positions by increasing bound, and the running sums of their bounds
+	std::vector<std::size_t> order;
+	std::vector<double> boundSums;
+
+	void Reset(const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings);
+	// length of the prefix of order whose bounds add up to less than threshold
+	std::size_t CountNonEssential(double threshold)const;
+};
+
+template <typename Predicat>
+void MaxScoreEvaluator::Score(const IndexSegment& segment, const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings, Predicat filter, TopDocuments& matched_documents) {
+	Reset(plusTerms, minusPostings);
+	const std::size_t termCount = plusTerms.size();
+	// bounds and scores multiply in a different order, the extra EPSILON absorbs the rounding
+	double threshold = matched_documents.GetEntryThreshold() - EPSILON;
+	std::size_t nonEssential = CountNonEssential(threshold);
+	for (int documentIndex = 0; nonEssential < termCount; ++documentIndex) {
+		// terms can turn essential again, so their cursors may lag behind
+		int next = PostingList::Cursor::END;
+		for (std::size_t k = nonEssential; k < termCount; ++k) {
+			PostingList::Cursor& cursor = cursors[order[k]];
+			cursor.Advance(documentIndex);
+			next = std::min(next, cursor.GetDocumentIndex());
+		}
+		if (next == PostingList::Cursor::END) {
+			break;
+		}
+		documentIndex = next;
+		if (!AcceptsDocument(segment, documentIndex, filter)) {
+			continue;
+		}
+		bool excluded = false;
+		for (PostingList::Cursor& cursor : minusCursors) {
+			cursor.Advance(documentIndex);
+			excluded = excluded || cursor.GetDocumentIndex() == documentIndex;
+		}
+		if (excluded) {
+			continue;
+		}
+
+		double score = 0.0;
+		for (std::size_t k = 0; k < termCount; ++k) {
+			const std::size_t term = order[k];
+			matched[term] = k >= nonEssential && cursors[term].GetDocumentIndex() == documentIndex;
+			if (matched[term]) {
+				contributions[term] = plusTerms[term].idf * cursors[term].GetCount() * segment.GetInverseLength(documentIndex);
+				score += contributions[term];
+			}
+		}
+		// strongest non-essential terms first, giving up once the rest cannot reach the threshold
+		bool competitive = true;
+		for (std::size_t k = nonEssential; k-- > 0;) {
+			if (score + boundSums[k] < threshold) {
+				competitive = false;
+				break;
+			}
+			const std::size_t term = order[k];
+			cursors[term].Advance(documentIndex);
+			if (cursors[term].GetDocumentIndex() == documentIndex) {
+				matched[term] = true;
+				contributions[term] = plusTerms[term].idf * cursors[term].GetCount() * segment.GetInverseLength(documentIndex);
+				score += contributions[term];
+			}
+		}
+		if (!competitive) {
+			continue;
+		}
+
+		double relevance = 0.0;
+		for (std::size_t term = 0; term < termCount; ++term) {
+			if (matched[term]) {
+				relevance += contributions[term];
+			}
+		}
+		matched_documents.Push({ segment.GetDocumentId(documentIndex), relevance, segment.GetRating(documentIndex) });
+		threshold = matched_documents.GetEntryThreshold() - EPSILON;
+		nonEssential = CountNonEssential(threshold);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "index_segment.h"
+
+// Size-tiered choice of the segments to merge. Every added document or batch lands in
+// a small segment of its own; segments fall into tiers by their document count and a
+// full tier is merged into one segment of a higher tier, so an index of n documents
+// keeps O(log n) segments. Segments with many removed documents are rewritten without them.
+struct MergePolicy {
+	// segments of one tier merged at once, at least 2
+	std::size_t segmentsPerMerge = 8;
+	// tier t holds the segments of [sizeRatio^t, sizeRatio^(t+1)) documents
+	double sizeRatio = 8.0;
+	// a segment with at least this share of removed documents is rewritten on its own
+	double removedRatio = 0.3;
+	// past this many segments writers merge synchronously, so searches stay fast when merging falls behind
+	std::size_t maxSegments = 64;
+	// merges run on a background thread, otherwise every change merges before it is published
+	bool backgroundMerging = true;
+
+	// positions of the segments to merge next in increasing order, empty when nothing needs merging
+	std::vector<std::size_t> FindMerge(const std::vector<std::shared_ptr<const IndexSegment>>& segments)const;
+	// positions of the smallest segments, merged when there are more than maxSegments
+	std::vector<std::size_t> FindForcedMerge(const std::vector<std::shared_ptr<const IndexSegment>>& segments)const;
+};
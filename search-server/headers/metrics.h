@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 0 compiles every timer and counter of the server out
+#ifndef SEARCH_SERVER_METRICS
+#define SEARCH_SERVER_METRICS 1
+#endif
+
+// Process-wide stage latency histograms and counters. Every thread writes only
+// its own block, so recording is a few relaxed stores without locks or shared
+// cache lines; a snapshot sums the blocks of all threads, exited ones included.
+class Metrics {
+public:
+	static constexpr bool ENABLED = SEARCH_SERVER_METRICS != 0;
+
+	enum class Stage {
+		// a whole FindTopDocuments call, with any execution policy
+		QUERY,
+		PARSE,
+		TERM_LOOKUP,
+		SCORING,
+		MINUS_EXCLUSION,
+		TOP_K,
+		// a whole AddDocument or AddDocuments call
+		INDEXING,
+		TOKENIZE,
+		BUILD_SEGMENT,
+		PUBLISH,
+		COUNT
+	};
+
+	enum class Counter {
+		QUERIES,
+		PARALLEL_QUERIES,
+		BATCH_QUERIES,
+		SEGMENTS_SCORED,
+		DOCUMENTS_ADDED,
+		DOCUMENTS_REMOVED,
+		COUNT
+	};
+
+	static constexpr std::size_t STAGE_COUNT = static_cast<std::size_t>(Stage::COUNT);
+	static constexpr std::size_t COUNTER_COUNT = static_cast<std::size_t>(Counter::COUNT);
+	// durations below 2^SUB_BUCKET_BITS ns are exact, every longer power of two is split into
+	// 2^SUB_BUCKET_BITS buckets, so a percentile is off by less than 1 / 2^SUB_BUCKET_BITS
+	static constexpr int SUB_BUCKET_BITS = 5;
+	// longer durations, about 18 minutes, fall into the last bucket
+	static constexpr int MAX_DURATION_BITS = 40;
+	static constexpr std::size_t BUCKET_COUNT = static_cast<std::size_t>(MAX_DURATION_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+	class Snapshot {
+	public:
+		Snapshot();
+
+		uint64_t GetCount(Stage stage)const;
+		std::chrono::nanoseconds GetTotal(Stage stage)const;
+		// upper bound of the bucket holding the quantile, 0 without samples
+		std::chrono::nanoseconds GetPercentile(Stage stage, double quantile)const;
+		uint64_t GetCounter(Counter counter)const;
+		// what was recorded after earlier, a snapshot taken before this one
+		Snapshot Since(const Snapshot& earlier)const;
+		// counts, totals and p50/p99/p999 of every stage and every counter
+		std::string ToJson()const;
+	private:
+		friend class Metrics;
+		std::array<std::vector<uint64_t>, STAGE_COUNT> buckets;
+		std::array<uint64_t, STAGE_COUNT> totals{};
+		std::array<uint64_t, COUNTER_COUNT> counters{};
+	};
+
+	static void Record(Stage stage, std::chrono::nanoseconds duration);
+	static void Increment(Counter counter, uint64_t value = 1);
+	static Snapshot GetSnapshot();
+
+	static const char* GetName(Stage stage);
+	static const char* GetName(Counter counter);
+	static std::size_t GetBucket(uint64_t nanoseconds);
+	static uint64_t GetBucketUpperBound(std::size_t bucket);
+private:
+	// written by its thread alone, read by snapshots
+	struct ThreadBlock {
+		std::array<std::array<std::atomic<uint64_t>, BUCKET_COUNT>, STAGE_COUNT> buckets{};
+		std::array<std::atomic<uint64_t>, STAGE_COUNT> totals{};
+		std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+	};
+
+	static ThreadBlock& GetThreadBlock();
+	static void Add(std::atomic<uint64_t>& value, uint64_t increment);
+};
+
+// Splits one call into stages: every Mark charges the time since the previous mark
+// to a stage, and the sums are recorded once, when the timer is destroyed, so a
+// stage that is entered for every segment still gives one sample per call.
+class StageTimer {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// records the marked stages only
+	StageTimer();
+	// total is recorded with the whole lifetime of the timer as well
+	explicit StageTimer(Metrics::Stage total);
+	~StageTimer();
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+	void Mark(Metrics::Stage stage);
+private:
+	Metrics::Stage total;
+	Clock::time_point start;
+	Clock::time_point last;
+	std::array<Clock::duration, Metrics::STAGE_COUNT> durations{};
+};
+
+inline void Metrics::Add(std::atomic<uint64_t>& value, uint64_t increment) {
+	// the owning thread is the only writer, a read-modify-write needs no lock prefix
+	value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+}
+
+inline void Metrics::Increment(Counter counter, uint64_t value) {
+	if constexpr (ENABLED) {
+		Add(GetThreadBlock().counters[static_cast<std::size_t>(counter)], value);
+	}
+}
+
+inline StageTimer::StageTimer() :StageTimer(Metrics::Stage::COUNT) {}
+
+inline StageTimer::StageTimer(Metrics::Stage total) :total(total) {
+	if constexpr (Metrics::ENABLED) {
+		start = Clock::now();
+		last = start;
+	}
+}
+
+inline StageTimer::~StageTimer() {
+	if constexpr (Metrics::ENABLED) {
+		const Clock::time_point end = Clock::now();
+		for (std::size_t stage = 0; stage < Metrics::STAGE_COUNT; ++stage) {
+			if (durations[stage] != Clock::duration::zero()) {
+				Metrics::Record(static_cast<Metrics::Stage>(stage), durations[stage]);
+			}
+		}
+		if (total != Metrics::Stage::COUNT) {
+			Metrics::Record(total, end - start);
+		}
+	}
+}
+
+inline void StageTimer::Mark(Metrics::Stage stage) {
+	if constexpr (Metrics::ENABLED) {
+		const Clock::time_point now = Clock::now();
+		durations[static_cast<std::size_t>(stage)] += now - last;
+		last = now;
+	}
+}
@@ -1,7 +1,10 @@
 #pragma once
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <iterator>
+#include <stdexcept>
+#include <type_traits>
 
 template <typename Iterator>
 class IteratorRange{
@@ -9,24 +12,22 @@ public:
 	IteratorRange(Iterator begin, Iterator end){
 		_begin = begin;
 		_end = end;
-		_size = std::distance(begin, end);
 	}
 
-	Iterator begin(){
+	Iterator begin()const{
 		return _begin;
 	}
 
-	Iterator end(){
+	Iterator end()const{
 		return _end;
 	}
 
-	std::size_t size(){
-		return _size;
+	std::size_t size()const{
+		return std::distance(_begin, _end);
 	}
 private:
 	Iterator _begin;
 	Iterator _end;
-	std::size_t _size;
 };
 
 template <typename Iterator>
@@ -37,42 +38,90 @@ std::ostream& operator<<(std::ostream& os, IteratorRange<Iterator> range){
 	return os;
 }
 
+// Lazy view of a sequence split into pages: a page is found only when it is reached,
+// in constant time for random access iterators and in pageSize steps for others.
 template <typename Iterator>
 class Paginator{
 public:
-	Paginator(Iterator begin, Iterator end, std::size_t pageCount){
-		std::size_t size = std::distance(begin, end);
-		std::size_t pages = (size % pageCount == 0) ? size / pageCount : size / pageCount + 1;
-		Iterator pageIt = begin;
-		for(unsigned i = 0; i < pages; i++){
-			Iterator bias = std::next(pageIt, pageCount);
-			if(i == (pages - 1)){
-				bias = end;
-			}
-			IteratorRange range(pageIt, bias);
-			list.push_back(range);
-			pageIt = std::next(pageIt, pageCount);
+	class PageIterator{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = IteratorRange<Iterator>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const value_type*;
+		using reference = value_type;
+
+		PageIterator(Iterator page, Iterator end, std::size_t pageSize): page(page), pageEnd(Advance(page, end, pageSize)), end(end), pageSize(pageSize){}
+
+		IteratorRange<Iterator> operator*()const{
+			return IteratorRange<Iterator>(page, pageEnd);
+		}
+
+		PageIterator& operator++(){
+			page = pageEnd;
+			pageEnd = Advance(page, end, pageSize);
+			return *this;
+		}
+
+		PageIterator operator++(int){
+			PageIterator previous = *this;
+			++*this;
+			return previous;
+		}
+
+		bool operator==(const PageIterator& other)const{
+			return page == other.page;
+		}
+
+		bool operator!=(const PageIterator& other)const{
+			return page != other.page;
+		}
+	private:
+		Iterator page;
+		Iterator pageEnd;
+		Iterator end;
+		std::size_t pageSize;
+	};
+
+	// throws std::invalid_argument for an empty page size
+	Paginator(Iterator begin, Iterator end, std::size_t pageSize): _begin(begin), _end(end), pageSize(pageSize){
+		if(pageSize == 0){
+			throw std::invalid_argument("page size must be positive");
 		}
 	}
 
-	auto begin() const{
-		return list.begin();
+	PageIterator begin() const{
+		return PageIterator(_begin, _end, pageSize);
 	}
 
-	auto end() const{
-		return list.end();
+	PageIterator end() const{
+		return PageIterator(_end, _end, pageSize);
 	}
 
-	std::size_t size(){
-		return list.size();
+	std::size_t size()const{
+		return (static_cast<std::size_t>(std::distance(_begin, _end)) + pageSize - 1) / pageSize;
 	}
 
 private:
-	std::vector<IteratorRange<Iterator>> list;
+	Iterator _begin;
+	Iterator _end;
+	std::size_t pageSize;
+
+	// position count elements after it, never past end
+	static Iterator Advance(Iterator it, Iterator end, std::size_t count){
+		if constexpr (std::is_base_of_v<std::random_access_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>){
+			return it + std::min<std::ptrdiff_t>(count, end - it);
+		}
+		else{
+			for(; count > 0 && it != end; --count){
+				++it;
+			}
+			return it;
+		}
+	}
 };
 
 template <typename Container>
 auto Paginate(const Container& c, size_t page_size) {
     return Paginator(begin(c), end(c), page_size);
 }
-
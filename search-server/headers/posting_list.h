@@ -0,0 +1,181 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Posting {
+	int documentIndex;
+	// occurrences of the term; tf is this count divided by the document length
+	uint32_t count;
+};
+
+// Compressed posting list. Postings are grouped into blocks of BLOCK_SIZE whose
+// document index gaps and counts are varint-encoded. A skip entry per block keeps
+// its first and last document index, so lookups and range scans only decode the
+// blocks they need. Appends go to a plain tail that is sealed into a block when full.
+// A deserialized list may read its block bytes in place from memory it shares, such
+// as a mapped snapshot; it copies them the first time it is changed.
+class PostingList {
+public:
+	static const std::size_t BLOCK_SIZE = 128;
+
+	// Forward-only reader for document-at-a-time scoring. Advance jumps over
+	// whole blocks through their skip entries instead of decoding them.
+	class Cursor {
+	public:
+		// document index of an exhausted cursor, greater than every real one
+		static constexpr int END = std::numeric_limits<int>::max();
+
+		explicit Cursor(const PostingList& list);
+		int GetDocumentIndex()const;
+		uint32_t GetCount()const;
+		void Next();
+		// moves to the first posting whose document index is not less than documentIndex
+		void Advance(int documentIndex);
+	private:
+		const PostingList* list;
+		std::size_t block = 0;
+		// postings of the current block not decoded yet
+		uint32_t remaining = 0;
+		const uint8_t* position = nullptr;
+		std::size_t tailPosition = 0;
+		int documentIndex = END;
+		uint32_t count = 0;
+
+		void EnterBlock(std::size_t next);
+	};
+
+	// documentIndex must exceed every index already stored
+	void Append(int documentIndex, uint32_t count);
+	bool Contains(int documentIndex)const;
+	std::size_t size()const;
+	bool empty()const;
+	// smallest and largest document index, read from the skip entries without decoding;
+	// the list must not be empty
+	int GetFirstDocumentIndex()const;
+	int GetLastDocumentIndex()const;
+
+	// calls callback(documentIndex, count) in increasing document index order
+	template <typename Callback>
+	void ForEach(Callback callback)const;
+	// the same restricted to document indexes in [begin, end)
+	template <typename Callback>
+	void ForEachInRange(int begin, int end, Callback callback)const;
+
+	std::size_t GetMemoryUsage()const;
+	std::string Serialize()const;
+	// copies the block bytes out of data, or reads them in place when storage owns data
+	static PostingList Deserialize(std::string_view data, std::shared_ptr<const void> storage = nullptr);
+private:
+	struct Block {
+		int firstDocumentIndex;
+		int lastDocumentIndex;
+		uint32_t postingCount;
+		uint32_t byteSize;
+		uint64_t offset;
+	};
+	std::vector<Block> blocks;
+	std::vector<uint8_t> bytes;
+	// block bytes read in place, used instead of bytes while storage is set
+	std::shared_ptr<const void> storage;
+	const uint8_t* sharedBytes = nullptr;
+	std::size_t sharedSize = 0;
+	std::vector<Posting> tail;
+	std::size_t postingCount = 0;
+
+	const uint8_t* GetBytes()const;
+	// copies shared block bytes into bytes before a change
+	void Detach();
+	void SealTail();
+	static void EncodeBlock(const std::vector<Posting>& postings, std::vector<uint8_t>& out);
+	static uint32_t ReadVarint(const uint8_t*& position);
+	// first block whose last document index is not less than documentIndex
+	std::size_t FindBlock(int documentIndex)const;
+};
+
+inline uint32_t PostingList::ReadVarint(const uint8_t*& position) {
+	uint32_t value = *position & 0x7f;
+	int shift = 7;
+	while (*position++ & 0x80) {
+		value |= static_cast<uint32_t>(*position & 0x7f) << shift;
+		shift += 7;
+	}
+	return value;
+}
+
+inline const uint8_t* PostingList::GetBytes()const {
+	return storage ? sharedBytes : bytes.data();
+}
+
+inline int PostingList::Cursor::GetDocumentIndex()const {
+	return documentIndex;
+}
+
+inline uint32_t PostingList::Cursor::GetCount()const {
+	return count;
+}
+
+inline void PostingList::Cursor::Next() {
+	while (remaining == 0 && block < list->blocks.size()) {
+		EnterBlock(block + 1);
+	}
+	if (remaining > 0) {
+		documentIndex += ReadVarint(position);
+		count = ReadVarint(position);
+		--remaining;
+	}
+	else if (tailPosition < list->tail.size()) {
+		documentIndex = list->tail[tailPosition].documentIndex;
+		count = list->tail[tailPosition].count;
+		++tailPosition;
+	}
+	else {
+		documentIndex = END;
+	}
+}
+
+template <typename Callback>
+void PostingList::ForEach(Callback callback)const {
+	const uint8_t* data = GetBytes();
+	for (const Block& block : blocks) {
+		const uint8_t* position = data + block.offset;
+		int documentIndex = block.firstDocumentIndex;
+		for (uint32_t i = 0; i < block.postingCount; ++i) {
+			documentIndex += ReadVarint(position);
+			callback(documentIndex, ReadVarint(position));
+		}
+	}
+	for (const Posting& posting : tail) {
+		callback(posting.documentIndex, posting.count);
+	}
+}
+
+template <typename Callback>
+void PostingList::ForEachInRange(int begin, int end, Callback callback)const {
+	for (std::size_t block = FindBlock(begin); block < blocks.size() && blocks[block].firstDocumentIndex < end; ++block) {
+		const uint8_t* position = GetBytes() + blocks[block].offset;
+		int documentIndex = blocks[block].firstDocumentIndex;
+		for (uint32_t i = 0; i < blocks[block].postingCount; ++i) {
+			documentIndex += ReadVarint(position);
+			const uint32_t count = ReadVarint(position);
+			if (documentIndex >= end) {
+				return;
+			}
+			if (documentIndex >= begin) {
+				callback(documentIndex, count);
+			}
+		}
+	}
+	for (const Posting& posting : tail) {
+		if (posting.documentIndex >= end) {
+			return;
+		}
+		if (posting.documentIndex >= begin) {
+			callback(posting.documentIndex, posting.count);
+		}
+	}
+}
@@ -6,7 +6,9 @@
 #include <tuple>
 #include "search_server.h"
 #include "document.h"
+#include "query_batch_result.h"
 
+QueryBatchResult ProcessQueriesBatch(const SearchServer& search_server, const std::vector<std::string>& queries);
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
 
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+#include "paginator.h"
+
+// Results of a query batch laid out back to back: the documents found for
+// query i occupy [GetOffsets()[i], GetOffsets()[i + 1]) of GetDocuments().
+class QueryBatchResult {
+public:
+	using Range = IteratorRange<std::vector<Document>::const_iterator>;
+
+	QueryBatchResult() = default;
+	QueryBatchResult(std::vector<Document> documents, std::vector<std::size_t> offsets);
+
+	std::size_t GetQueryCount()const;
+	Range operator[](std::size_t query)const;
+	const std::vector<Document>& GetDocuments()const;
+	const std::vector<std::size_t>& GetOffsets()const;
+	// hands the joined documents over without copying them
+	std::vector<Document> ExtractDocuments();
+private:
+	std::vector<Document> documents;
+	std::vector<std::size_t> offsets{ 0 };
+};
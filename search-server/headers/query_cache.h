@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+
+// Bounded thread-safe LRU cache of search results. Every entry remembers the
+// index generation it was computed for and is never served for another one.
+class QueryCache {
+public:
+	struct Statistics {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		std::size_t size;
+	};
+
+	explicit QueryCache(std::size_t capacity);
+
+	bool Find(const std::string& key, uint64_t generation, std::vector<Document>& result);
+	void Insert(std::string key, uint64_t generation, std::vector<Document> documents);
+	void Clear();
+	Statistics GetStatistics()const;
+private:
+	struct Entry {
+		std::string key;
+		uint64_t generation;
+		std::vector<Document> documents;
+	};
+	std::size_t capacity;
+	mutable std::mutex mutex;
+	// most recently used entries first
+	std::list<Entry> entries;
+	std::unordered_map<std::string_view, std::list<Entry>::iterator> entriesByKey;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "posting_list.h"
+
+// plus and minus words of a query, views into the query text
+struct ParsedQuery {
+	std::vector<std::string_view> plusWords;
+	std::vector<std::string_view> minusWords;
+};
+
+// plus word resolved against one segment
+struct QueryTerm {
+	const PostingList* postings;
+	double idf;
+	// largest tf of the word in the segment
+	double maxTermFrequency;
+};
+
+// Scratch buffers for parsing, normalizing and scoring one query at a time.
+// Reusing a context, one per thread, stops the allocations once its buffers
+// have grown to the largest query seen; only the returned results are allocated.
+class QueryContext {
+private:
+	friend class SearchServer;
+	std::vector<std::string_view> tokens;
+	ParsedQuery query;
+	// idf of every plus word, shared by all segments
+	std::vector<double> idfs;
+	std::vector<QueryTerm> plusTerms;
+	std::vector<const PostingList*> minusPostings;
+	// query cache key, rebuilt in place for every query
+	std::string key;
+};
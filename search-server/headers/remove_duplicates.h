@@ -1,3 +1,15 @@
 #pragma once
+#include <vector>
+
 #include "search_server.h"
-void RemoveDuplicates(SearchServer& searchServer);
+
+// Removes every document whose set of words equals that of a document with a
+// smaller id and returns the removed ids in increasing order. Documents are
+// fingerprinted in parallel; equal fingerprints are confirmed word by word.
+std::vector<int> RemoveDuplicates(SearchServer& searchServer);
+
+// Removes every document whose words have a Jaccard similarity of at least
+// threshold, in (0, 1], with a kept document of a smaller id. Candidates come
+// from MinHash signatures banded for the threshold and are confirmed exactly,
+// so documents only slightly above the threshold may be missed.
+std::vector<int> RemoveNearDuplicates(SearchServer& searchServer, double threshold);
@@ -1,38 +1,106 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
-#include <deque>
 
 #include "search_server.h"
 
+// Counts find requests over a sliding window of wall-clock time and may be shared
+// by many request threads. The window is a ring of time buckets; each thread adds
+// to its own stripe of the ring with atomic operations, and every counter carries
+// the bucket number it counts for, so a counter left from an earlier turn of the
+// ring restarts on its next increment without any lock or separate reset.
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer& searchServer);
+	using Clock = std::chrono::steady_clock;
+
+	// upper bounds of the latency classes, the last class is unbounded
+	static constexpr std::array<Clock::duration, 4> LATENCY_BOUNDS = {
+		std::chrono::microseconds(100),
+		std::chrono::milliseconds(1),
+		std::chrono::milliseconds(10),
+		std::chrono::milliseconds(100)
+	};
+	static constexpr std::size_t LATENCY_CLASSES = LATENCY_BOUNDS.size() + 1;
+
+	struct Statistics {
+		uint64_t requests = 0;
+		uint64_t noResultRequests = 0;
+		// requests for documents of a status, by status
+		std::array<uint64_t, IndexSegment::STATUS_COUNT> statusRequests{};
+		// requests with a custom predicate
+		uint64_t predicateRequests = 0;
+		std::array<uint64_t, LATENCY_CLASSES> latencyRequests{};
+		// time the counts cover, the window once the queue is older than it
+		double seconds = 0;
+
+		double GetRequestsPerSecond()const;
+		double GetNoResultRate()const;
+	};
+
+	// throws std::invalid_argument unless 0 < resolution <= window
+	explicit RequestQueue(const SearchServer& searchServer, Clock::duration window = std::chrono::hours(24), Clock::duration resolution = std::chrono::minutes(1));
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& rawQuery, DocumentPredicate documentPredicate);
 
 	std::vector<Document> AddFindRequest(const std::string& rawQuery, DocumentStatus status);
 
 	std::vector<Document> AddFindRequest(const std::string& rawQuery);
+
+	// the same requests searched in the buffers of context, see query_context.h
+	template <typename DocumentPredicate>
+	std::vector<Document> AddFindRequest(QueryContext& context, const std::string& rawQuery, DocumentPredicate documentPredicate);
+	std::vector<Document> AddFindRequest(QueryContext& context, const std::string& rawQuery, DocumentStatus status);
+	std::vector<Document> AddFindRequest(QueryContext& context, const std::string& rawQuery);
 	int GetNoResultRequests()const;
+	Statistics GetStatistics()const;
 private:
-	struct QueryResult {
-		uint64_t timestamp;
-		unsigned results;
+	// counter layout of a bucket
+	static constexpr std::size_t NO_RESULTS = 0;
+	static constexpr std::size_t FIRST_STATUS = 1;
+	static constexpr std::size_t PREDICATE = FIRST_STATUS + IndexSegment::STATUS_COUNT;
+	static constexpr std::size_t FIRST_LATENCY = PREDICATE + 1;
+	static constexpr std::size_t COUNTER_COUNT = FIRST_LATENCY + LATENCY_CLASSES;
+	// a counter keeps its bucket number in the high bits and its count in the low ones
+	static constexpr int COUNT_BITS = 32;
+
+	// one bucket of one stripe, on its own cache lines
+	struct alignas(64) Bucket {
+		std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
 	};
-	std::deque<QueryResult> requests_;
-	int no_results_requests_;
-	uint64_t current_time_;
-	const static uint64_t min_in_day_ = 1440;
+
 	const SearchServer &search;
-	void dequeAction(unsigned results_num);
-	void push(const QueryResult& result);
-	void pop();
+	const Clock::time_point start;
+	const Clock::duration resolution;
+	std::size_t bucketCount;
+	std::size_t stripeCount;
+	// bucketCount buckets of every stripe, stripe after stripe
+	std::unique_ptr<Bucket[]> buckets;
+
+	void Record(std::size_t requestKind, std::size_t resultCount, Clock::duration latency);
+	uint64_t GetBucketNumber(Clock::time_point time)const;
+	static uint64_t GetTag(uint64_t bucketNumber);
+	static void Increment(std::atomic<uint64_t>& counter, uint64_t tag);
+	static uint64_t Read(const std::atomic<uint64_t>& counter, uint64_t tag);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& rawQuery, DocumentPredicate documentPredicate) {
+	const Clock::time_point requestStart = Clock::now();
 	std::vector<Document> result = search.FindTopDocuments(rawQuery, documentPredicate);
-	dequeAction(result.size());
+	Record(PREDICATE, result.size(), Clock::now() - requestStart);
+	return result;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::AddFindRequest(QueryContext& context, const std::string& rawQuery, DocumentPredicate documentPredicate) {
+	const Clock::time_point requestStart = Clock::now();
+	std::vector<Document> result = search.FindTopDocuments(context, rawQuery, documentPredicate);
+	Record(PREDICATE, result.size(), Clock::now() - requestStart);
 	return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense relevance accumulator indexed by the internal document index.
+// Reset is O(1) thanks to generation stamps, and once the buffers have grown
+// to the index size scoring a query does not allocate.
+class ScoreAccumulator {
+public:
+	// accumulator owned by the calling thread, reused across queries
+	static ScoreAccumulator& ForCurrentThread();
+
+	void Reset(std::size_t documentCount);
+	void Add(int documentIndex, double score);
+	// drops a document from the current query; it must not be added again afterwards
+	void Erase(int documentIndex);
+	// documents added since the last Reset, erased ones included
+	std::size_t GetTouchedCount()const;
+
+	template <typename Callback>
+	void ForEach(Callback callback)const;
+private:
+	std::vector<double> scores;
+	std::vector<uint32_t> stamps;
+	std::vector<int> touched;
+	uint32_t generation = 0;
+};
+
+template <typename Callback>
+void ScoreAccumulator::ForEach(Callback callback)const {
+	for (int documentIndex : touched) {
+		if (stamps[documentIndex] == generation) {
+			callback(documentIndex, scores[documentIndex]);
+		}
+	}
+}
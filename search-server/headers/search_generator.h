@@ -1,12 +1,26 @@
 #pragma once
+#include <cmath>
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <algorithm>
 #include <random>
 
+// Random words, dictionaries and queries. The same seed gives the same sequence,
+// so generated corpora can be reproduced across runs and machines.
 class SearchGenerator {
 public:
+    explicit SearchGenerator(uint32_t seed = std::mt19937::default_seed) : generator(seed) {
+    }
+
+    // words are then picked from a dictionary with probability proportional to
+    // 1 / rank^exponent, rank being the position in the dictionary; 0 picks uniformly
+    void SetZipfExponent(double exponent) {
+        zipf_exponent = exponent;
+        zipf_weights.clear();
+    }
+
     std::string GenerateWord(int max_length) {
         const int length = std::uniform_int_distribution(1, max_length)(generator);
         std::string word;
@@ -36,19 +50,39 @@ public:
             if (std::uniform_real_distribution<>(0, 1)(generator) < minus_prob) {
                 query.push_back('-');
             }
-            query += dictionary[std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+            query += PickWord(dictionary);
         }
         return query;
     }
 
-    std::vector<std::string> GenerateQueries(const std::vector<std::string>& dictionary, int query_count, int max_word_count) {
+    std::vector<std::string> GenerateQueries(const std::vector<std::string>& dictionary, int query_count, int max_word_count, double minus_prob = 0) {
         std::vector<std::string> queries;
         queries.reserve(query_count);
         for (int i = 0; i < query_count; ++i) {
-            queries.push_back(GenerateQuery(dictionary, max_word_count));
+            queries.push_back(GenerateQuery(dictionary, max_word_count, minus_prob));
         }
         return queries;
     }
 private:
 	std::mt19937 generator;
+    double zipf_exponent = 0.0;
+    // cumulative weights of the ranks, built for the size of the last dictionary
+    std::vector<double> zipf_weights;
+
+    const std::string& PickWord(const std::vector<std::string>& dictionary) {
+        if (zipf_exponent == 0.0) {
+            return dictionary[std::uniform_int_distribution<int>(0, dictionary.size() - 1)(generator)];
+        }
+        if (zipf_weights.size() != dictionary.size()) {
+            zipf_weights.resize(dictionary.size());
+            double sum = 0.0;
+            for (std::size_t rank = 0; rank < dictionary.size(); ++rank) {
+                sum += 1.0 / std::pow(static_cast<double>(rank + 1), zipf_exponent);
+                zipf_weights[rank] = sum;
+            }
+        }
+        const double point = std::uniform_real_distribution<>(0, zipf_weights.back())(generator);
+        const auto rank = std::upper_bound(zipf_weights.begin(), zipf_weights.end(), point) - zipf_weights.begin();
+        return dictionary[std::min<std::size_t>(rank, dictionary.size() - 1)];
+    }
 };
\ No newline at end of file
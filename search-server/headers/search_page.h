@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "document.h"
+
+// Where a paginated search stopped: the last document returned and the index
+// generation it was ranked in. A default cursor asks for the first page, the
+// next ones come back with every page.
+class SearchCursor {
+public:
+	SearchCursor() = default;
+
+	// true once a page came back short, no documents follow it
+	bool IsEnd()const;
+	uint64_t GetGeneration()const;
+private:
+	friend class SearchServer;
+	Document last;
+	uint64_t generation = 0;
+	bool started = false;
+	bool end = false;
+};
+
+struct SearchPage {
+	std::vector<Document> documents;
+	SearchCursor next;
+	// the index changed since the cursor was made, so documents may repeat or be
+	// missed across the pages while the ranking of this page itself stays exact
+	bool stale = false;
+};
@@ -15,16 +15,51 @@
 #include <typeinfo>
 #include <string_view>
 #include <type_traits>
-#include <future>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 
-#include "concurrent_map.h"
 #include "document.h"
+#include "document_filter.h"
+#include "indexing.h"
+#include "index_segment.h"
+#include "index_version.h"
+#include "max_score_evaluator.h"
+#include "merge_policy.h"
+#include "metrics.h"
+#include "query_batch_result.h"
+#include "query_cache.h"
+#include "query_context.h"
+#include "score_accumulator.h"
+#include "search_page.h"
+#include "segmented_index.h"
+#include "thread_pool.h"
+#include "top_documents.h"
 
 using namespace std::string_literals;
 
-const unsigned MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+// default number of documents returned by FindTopDocuments
+const std::size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+// parallel search does not split the index into smaller ranges than this
+const int MIN_DOCUMENTS_PER_THREAD = 4096;
+// AddDocuments tokenizes at least this many documents per task
+const std::size_t MIN_DOCUMENTS_PER_CHUNK = 64;
+// AddDocument merges its documents into the segment it published last until it holds this many;
+// every call copies that segment, so the cost of an add grows with it
+const std::size_t MAX_PENDING_DOCUMENTS = 8;
+
+// how sequential and batch searches score a segment; both give the same results,
+// the parallel search always scores term at a time over document ranges
+enum class ScoringMode {
+	// every posting of every plus word is accumulated, minus words are erased afterwards
+	TERM_AT_A_TIME,
+	// document at a time, skipping documents that cannot enter the top, see max_score_evaluator.h
+	MAX_SCORE
+};
 
+// Searches run on the index version current when they start and never wait for writers:
+// AddDocument, AddDocuments and RemoveDocument build new segments, serialized among
+// themselves, and publish the next version atomically, see segmented_index.h.
 class SearchServer{
 public:
 	SearchServer();
@@ -35,74 +70,157 @@ public:
 	template<typename Container>
 	SearchServer(const Container& stopWordsContainer);
 
+	// visible to every read that starts after it returns; the document replaces the last
+	// segment it added by a copy holding one more, so a run of calls adds a segment per
+	// MAX_PENDING_DOCUMENTS documents instead of one per document
 	void AddDocument(int documentId, std::string_view document, DocumentStatus status, const std::vector<int>& docRating);
+	// tokenizes the batch in parallel and merges per-thread postings into the index in one
+	// pass; either every document is added or, if one of them is invalid, none is
+	IndexingStatistics AddDocuments(const std::vector<DocumentInput>& batch);
+	// AddDocuments in two steps, so that the next batch can be tokenized while one is published:
+	// PrepareDocuments validates and tokenizes a batch into its own segment without holding the
+	// write lock, CommitDocuments checks the ids against the index again and publishes the segment;
+	// a prepared batch no longer refers to the texts of its documents
+	PreparedDocuments PrepareDocuments(const std::vector<DocumentInput>& batch)const;
+	void CommitDocuments(const PreparedDocuments& prepared);
 
 	template <typename Predicat>
-	std::vector<Document> FindTopDocuments(std::string_view rawQuery, Predicat filter)const;
-	std::vector<Document> FindTopDocuments(std::string_view rawQuery, DocumentStatus status)const;
+	std::vector<Document> FindTopDocuments(std::string_view rawQuery, Predicat filter, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
+	std::vector<Document> FindTopDocuments(std::string_view rawQuery, DocumentStatus status, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
 	std::vector<Document> FindTopDocuments(std::string_view rawQuery)const;
 
+	// the same sequential searches run in the buffers of context, see query_context.h
+	template <typename Predicat>
+	std::vector<Document> FindTopDocuments(QueryContext& context, std::string_view rawQuery, Predicat filter, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
+	std::vector<Document> FindTopDocuments(QueryContext& context, std::string_view rawQuery, DocumentStatus status = DocumentStatus::ACTUAL, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
+
 	template <typename Predicat>
-	std::vector<Document> FindTopDocumentsParallel(std::string_view rawQuery, Predicat filter)const;
+	std::vector<Document> FindTopDocumentsParallel(std::string_view rawQuery, Predicat filter, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
 
 	template <typename Execution, typename Predicat>
-	std::vector<Document> FindTopDocuments(const Execution& policy, std::string_view rawQuery, Predicat filter)const;
+	std::vector<Document> FindTopDocuments(const Execution& policy, std::string_view rawQuery, Predicat filter, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
 	template <typename Execution>
-	std::vector<Document> FindTopDocuments(const Execution& policy, std::string_view rawQuery, DocumentStatus status)const;
+	std::vector<Document> FindTopDocuments(const Execution& policy, std::string_view rawQuery, DocumentStatus status, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
 	template <typename Execution>
 	std::vector<Document> FindTopDocuments(const Execution& policy, std::string_view rawQuery)const;
 
 	
 
+	// scores a whole batch at once: every query is parsed once, identical queries
+	// are scored once and every distinct word is looked up in the index once
+	QueryBatchResult FindTopDocumentsBatch(const std::vector<std::string>& rawQueries, DocumentStatus status = DocumentStatus::ACTUAL, std::size_t topCount = MAX_RESULT_DOCUMENT_COUNT)const;
+
+	// the page of FindTopDocuments results that follows cursor: only documents ranked after
+	// the cursor compete for the pageSize places, so a deep page costs as much as the first;
+	// pass the returned cursor back for the next page. Pages are not cached;
+	// throws std::invalid_argument for an empty page size
+	template <typename Predicat>
+	SearchPage FindTopDocumentsPage(std::string_view rawQuery, Predicat filter, const SearchCursor& cursor, std::size_t pageSize = MAX_RESULT_DOCUMENT_COUNT)const;
+	SearchPage FindTopDocumentsPage(std::string_view rawQuery, DocumentStatus status, const SearchCursor& cursor, std::size_t pageSize = MAX_RESULT_DOCUMENT_COUNT)const;
+	SearchPage FindTopDocumentsPage(std::string_view rawQuery, const SearchCursor& cursor)const;
+
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy& _Ex, std::string_view rawQuery, int documentId);
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy& _Ex, std::string_view rawQuery, int documentId);
 	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view rawQuery, int documentId)const;
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(QueryContext& context, std::string_view rawQuery, int documentId)const;
 	
-	std::set<int>::const_iterator begin()const;
-	std::set<int>::const_iterator end()const;
+	// ids of the current version, which the range keeps alive; begin() pins the version
+	// for the iteration it starts and end() is the end of every iteration
+	DocumentIdRange GetDocumentIds()const;
+	DocumentIdRange::Iterator begin()const;
+	DocumentIdRange::Iterator end()const;
 	unsigned GetDocumentCount()const;
-	const std::map<std::string_view, double>& GetWordFrequencies(int documentId)const;
+	// empty for unknown and removed ids; the view keeps what it reads alive
+	WordFrequencies GetWordFrequencies(int documentId)const;
 
+	// a removal only marks the document, its memory is reclaimed by merges or Compact
 	template<typename Execution>
-	void RemoveDocument(Execution&& _Ex, int documentId);
+	void RemoveDocument(Execution&&, int documentId);
 
 	void RemoveDocument(int documentId);
+	// rewrites every segment holding removed documents without them, dropping terms
+	// no document has left; returns what this pass merged and reclaimed
+	SegmentedIndex::Statistics Compact();
+
+	// every parallel path of the server runs on this pool, ThreadPool::GetDefault() unless replaced
+	void SetThreadPool(std::shared_ptr<ThreadPool> pool);
+	ThreadPool& GetThreadPool()const;
+
+	// writes a versioned, checksummed binary snapshot of the index, see snapshot.h;
+	// the file at path is replaced atomically once the snapshot is complete
+	void Save(const std::string& path)const;
+	// maps a snapshot written by Save and restores the server without tokenizing any text or
+	// decoding any posting; posting blocks, the forward index and the terms of the term
+	// statistics are read from the mapping, which stays open while they are in use
+	static SearchServer Load(const std::string& path);
+
+	// caches the results of status-only searches, calls with custom predicates bypass it;
+	// safe while other threads search, a search in flight keeps the cache it started with
+	void EnableQueryCache(std::size_t capacity);
+	void DisableQueryCache();
+	QueryCache::Statistics GetQueryCacheStatistics()const;
+	IndexSegment::Statistics GetIndexStatistics()const;
+
+	void SetMergePolicy(const MergePolicy& policy);
+	MergePolicy GetMergePolicy()const;
+	// runs the merges the policy asks for now instead of in the background
+	void MergeSegments();
+	SegmentedIndex::Statistics GetMergeStatistics()const;
+
+	void SetScoringMode(ScoringMode mode);
+	ScoringMode GetScoringMode()const;
 private:
-	struct RatingStatus{
-		int rating;
-		DocumentStatus status;
-	};
-	std::set<int> documentsIds;
-	std::map<int, std::map<std::string, double>> wordFreq;	
-	std::map<std::string, std::map<int, double>> documents;
-	std::set<std::string> stopWords;
-	std::map<int, RatingStatus> documentsRatingStatus;
-	struct Query {
-		std::vector<std::string_view> plusWords;
-		std::vector<std::string_view> minusWords;
-	};
+	std::set<std::string, std::less<>> stopWords;
+	std::unique_ptr<SegmentedIndex> index = std::make_unique<SegmentedIndex>();
+	std::shared_ptr<ThreadPool> threadPool = ThreadPool::GetDefault();
+	// only accessed through std::atomic_load and std::atomic_store, see GetQueryCache
+	std::shared_ptr<QueryCache> queryCache;
+	ScoringMode scoringMode = ScoringMode::MAX_SCORE;
+	// segment last published by AddDocument, guarded by the write lock; the next call
+	// replaces it while it is still the last segment of the index and not full
+	std::shared_ptr<const IndexSegment> pendingSegment;
 	struct QueryWord {
 		std::string_view data;
 		bool isMinus;
 		bool isStop;
 	};
-	bool CheckWord(const std::string& word)const;
-	void CheckDocumentId(int documentId)const;
+	static bool CheckWord(std::string_view word);
+	void CheckDocumentId(const IndexVersion& current, int documentId)const;
+	static void CheckStatus(DocumentStatus status);
+	std::shared_ptr<const IndexVersion> GetVersion()const;
+	std::shared_ptr<QueryCache> GetQueryCache()const;
 	static int ComputeAverageRating(const std::vector<int>& ratings);
-	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, const std::set<std::string>& stopWords)const;
-	bool IsStopWord(const std::string& word)const;
-	Query ParseQuery(std::string_view text)const;
-	QueryWord ParseQueryWord(std::string_view word)const;
+	std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, const std::set<std::string, std::less<>>& stopWords)const;
+	bool IsStopWord(std::string_view word)const;
+	ParsedQuery ParseQuery(std::string_view text)const;
+	// splits text into tokens and fills query, both cleared first
+	void ParseQuery(std::string_view text, std::vector<std::string_view>& tokens, ParsedQuery& query)const;
+	QueryWord ParseQueryWord(std::string_view word, bool hasControlCharacter)const;
+	static void RemoveDuplicateWords(ParsedQuery& query);
+	// identical for queries that differ only in word order and repetitions
+	static std::string GetQueryKey(const ParsedQuery& query);
+	static void AppendQueryKey(const ParsedQuery& query, std::string& key);
+	// overwrites key, reusing its buffer
+	static void GetCacheKey(const ParsedQuery& query, DocumentStatus status, std::size_t topCount, std::string& key);
+	template <typename Compute>
+	std::vector<Document> FindTopDocumentsCached(const IndexVersion& current, const ParsedQuery& queryWords, DocumentStatus status, std::size_t topCount, std::string& key, Compute compute)const;
+	// segment holding the document; throws std::out_of_range for unknown and removed ids
+	static const IndexSegment& FindDocumentSegment(const IndexVersion& current, int documentId, int& documentIndex);
+	static bool ContainsDocument(const IndexSegment& segment, std::string_view word, int documentIndex);
+	PreparedDocuments PrepareDocuments(const std::vector<DocumentInput>& batch, StageTimer& timer)const;
+	void CommitDocuments(const PreparedDocuments& prepared, StageTimer& timer);
 	template <typename Predicat>
-	std::vector<Document> FindAllDocuments(const Query& queryWords, Predicat filter)const;
+	std::vector<Document> FindAllDocuments(const IndexVersion& current, QueryContext& context, Predicat filter, TopDocuments matched_documents, StageTimer& timer)const;
 	template <typename Predicat>
-	std::vector<Document> FindAllDocumentsParallel(const Query& queryWords, Predicat filter)const;
+	std::vector<Document> FindAllDocumentsParallel(const IndexVersion& current, const ParsedQuery& queryWords, Predicat filter, std::size_t topCount, StageTimer& timer)const;
+	template <typename Predicat>
+	void ScoreDocuments(const IndexSegment& segment, const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings, Predicat filter, TopDocuments& matched_documents, StageTimer& timer)const;
 };
 
 template<typename Container>
 SearchServer::SearchServer(const Container& stopWordsContainer){
 	for (std::string_view wordView : stopWordsContainer) {
-		if (!CheckWord(static_cast<std::string>(wordView))) {
+		if (!CheckWord(wordView)) {
 			throw std::invalid_argument("stop word contains a wrong character");
 		}
 		stopWords.insert(static_cast<std::string>(wordView));
@@ -110,79 +228,56 @@ SearchServer::SearchServer(const Container& stopWordsContainer){
 }
 
 template <typename Predicat>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view rawQuery, Predicat filter)const{
-	Query queryWords = ParseQuery(rawQuery);	
-
-	std::sort(queryWords.plusWords.begin(), queryWords.plusWords.end());
-	std::sort(queryWords.minusWords.begin(), queryWords.minusWords.end());
-
-	auto lastMinus = std::unique(queryWords.minusWords.begin(), queryWords.minusWords.end());
-	queryWords.minusWords.erase(lastMinus, queryWords.minusWords.end());
-
-	auto lastPlus = std::unique(queryWords.plusWords.begin(), queryWords.plusWords.end());
-	queryWords.plusWords.erase(lastPlus, queryWords.plusWords.end());
-
-	std::vector<Document> allDoc = FindAllDocuments(queryWords, filter);
-	std::sort(allDoc.begin(), allDoc.end(), [](const Document& lhs, const Document& rhs){
-		if(std::abs(lhs.relevance - rhs.relevance) < EPSILON){
-			return lhs.rating > rhs.rating;
-		}
-		return lhs.relevance > rhs.relevance;
-	});
-	if(allDoc.size() > MAX_RESULT_DOCUMENT_COUNT){
-		allDoc.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-	return allDoc;
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view rawQuery, Predicat filter, std::size_t topCount)const{
+	QueryContext context;
+	return FindTopDocuments(context, rawQuery, filter, topCount);
 }
 
 template <typename Predicat>
-std::vector<Document>  SearchServer::FindTopDocumentsParallel(std::string_view rawQuery, Predicat filter)const {
-	Query queryWords = ParseQuery(rawQuery);
-
+std::vector<Document> SearchServer::FindTopDocuments(QueryContext& context, std::string_view rawQuery, Predicat filter, std::size_t topCount)const{
+	StageTimer timer(Metrics::Stage::QUERY);
+	Metrics::Increment(Metrics::Counter::QUERIES);
+	ParseQuery(rawQuery, context.tokens, context.query);
+	RemoveDuplicateWords(context.query);
+	timer.Mark(Metrics::Stage::PARSE);
+	return FindAllDocuments(*GetVersion(), context, filter, TopDocuments(topCount), timer);
+}
 
-	std::future<void> ps = std::async(std::sort<decltype(queryWords.plusWords.begin())>, queryWords.plusWords.begin(), queryWords.plusWords.end());
-	std::future<void> ms = std::async(std::sort<decltype(queryWords.minusWords.begin())>, queryWords.minusWords.begin(), queryWords.minusWords.end());
-	ps.get();
-	ms.get();
-	
-	std::future<std::vector<std::string_view>::iterator> lastMinus = std::async(std::unique<decltype(queryWords.minusWords.begin())>, queryWords.minusWords.begin(), queryWords.minusWords.end());
-	std::future<std::vector<std::string_view>::iterator> lastPlus = std::async(std::unique<decltype(queryWords.plusWords.begin())>, queryWords.plusWords.begin(), queryWords.plusWords.end());
-	
-	std::future<void> pe = std::async([&queryWords, &lastPlus]{ queryWords.plusWords.erase(lastPlus.get(), queryWords.plusWords.end()); });
-	std::future<void> me = std::async([&queryWords, &lastMinus] { queryWords.minusWords.erase(lastMinus.get(), queryWords.minusWords.end()); });
-	pe.get();
-	me.get();
-
-	std::vector<Document> allDoc = FindAllDocumentsParallel(queryWords, filter);
-	std::sort(allDoc.begin(), allDoc.end(), [](const Document& lhs, const Document& rhs) {
-		if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-			return lhs.rating > rhs.rating;
-		}
-		return lhs.relevance > rhs.relevance;
-		});
-	if (allDoc.size() > MAX_RESULT_DOCUMENT_COUNT) {
-		allDoc.resize(MAX_RESULT_DOCUMENT_COUNT);
-	}
-	return allDoc;
+template <typename Predicat>
+std::vector<Document>  SearchServer::FindTopDocumentsParallel(std::string_view rawQuery, Predicat filter, std::size_t topCount)const {
+	StageTimer timer(Metrics::Stage::QUERY);
+	Metrics::Increment(Metrics::Counter::QUERIES);
+	Metrics::Increment(Metrics::Counter::PARALLEL_QUERIES);
+	ParsedQuery queryWords = ParseQuery(rawQuery);
+	RemoveDuplicateWords(queryWords);
+	timer.Mark(Metrics::Stage::PARSE);
+	return FindAllDocumentsParallel(*GetVersion(), queryWords, filter, topCount, timer);
 }
 
 template <typename Execution, typename Predicat>
-std::vector<Document>  SearchServer::FindTopDocuments(const Execution& policy, std::string_view rawQuery, Predicat filter)const{
+std::vector<Document>  SearchServer::FindTopDocuments(const Execution&, std::string_view rawQuery, Predicat filter, std::size_t topCount)const{
 	if constexpr (std::is_same_v<Execution, std::execution::sequenced_policy>){
-		return FindTopDocuments(rawQuery, filter);
+		return FindTopDocuments(rawQuery, filter, topCount);
 	}
-	return FindTopDocumentsParallel(rawQuery, filter);
+	return FindTopDocumentsParallel(rawQuery, filter, topCount);
 }
 
 template <typename Execution>
-std::vector<Document>  SearchServer::FindTopDocuments(const Execution& policy, std::string_view rawQuery, DocumentStatus status)const{
+std::vector<Document>  SearchServer::FindTopDocuments(const Execution&, std::string_view rawQuery, DocumentStatus status, std::size_t topCount)const{
 	if constexpr (std::is_same_v<Execution, std::execution::sequenced_policy>) {
-		return FindTopDocuments(rawQuery, status);
+		return FindTopDocuments(rawQuery, status, topCount);
 	}
-	return FindTopDocuments(policy, rawQuery, [status](int documentId, DocumentStatus documentStatus, int rating) {
-		return documentStatus == status;
+	StageTimer timer(Metrics::Stage::QUERY);
+	Metrics::Increment(Metrics::Counter::QUERIES);
+	Metrics::Increment(Metrics::Counter::PARALLEL_QUERIES);
+	ParsedQuery queryWords = ParseQuery(rawQuery);
+	RemoveDuplicateWords(queryWords);
+	timer.Mark(Metrics::Stage::PARSE);
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	std::string key;
+	return FindTopDocumentsCached(*current, queryWords, status, topCount, key, [&] {
+		return FindAllDocumentsParallel(*current, queryWords, StatusFilter{ status }, topCount, timer);
 	});
-	
 }
 
 template <typename Execution>
@@ -193,121 +288,209 @@ std::vector<Document>  SearchServer::FindTopDocuments(const Execution& policy, s
 	return FindTopDocuments(policy, rawQuery, DocumentStatus::ACTUAL);
 }
 
+template <typename Compute>
+std::vector<Document> SearchServer::FindTopDocumentsCached(const IndexVersion& current, const ParsedQuery& queryWords, DocumentStatus status, std::size_t topCount, std::string& key, Compute compute)const {
+	const std::shared_ptr<QueryCache> cache = GetQueryCache();
+	if (!cache) {
+		return compute();
+	}
+	GetCacheKey(queryWords, status, topCount, key);
+	std::vector<Document> result;
+	if (!cache->Find(key, current.GetGeneration(), result)) {
+		result = compute();
+		cache->Insert(key, current.GetGeneration(), result);
+	}
+	return result;
+}
+
 template <typename Predicat>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& queryWords, Predicat filter)const{
-	std::vector<Document> matched_documents;
-	std::map<int, double> documentToRelevance;
-	for(std::string_view word : queryWords.plusWords){		
-		if(documents.find(static_cast<std::string>(word)) != documents.end()){
-			double idf = log(GetDocumentCount() * 1.0 /  documents.at(static_cast<std::string>(word)).size());
-			for(const auto& [documentId, documentTf] : documents.at(static_cast<std::string>(word))){
-				if(filter(documentId, documentsRatingStatus.at(documentId).status, documentsRatingStatus.at(documentId).rating)){
-					double tdIdf = idf * documentTf;
-					documentToRelevance[documentId] += tdIdf;
-				}
+SearchPage SearchServer::FindTopDocumentsPage(std::string_view rawQuery, Predicat filter, const SearchCursor& cursor, std::size_t pageSize)const{
+	if(pageSize == 0){
+		throw std::invalid_argument("page size must be positive");
+	}
+	SearchPage page;
+	page.next = cursor;
+	if(cursor.end){
+		return page;
+	}
+	StageTimer timer(Metrics::Stage::QUERY);
+	Metrics::Increment(Metrics::Counter::QUERIES);
+	QueryContext context;
+	ParseQuery(rawQuery, context.tokens, context.query);
+	RemoveDuplicateWords(context.query);
+	timer.Mark(Metrics::Stage::PARSE);
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	TopDocuments matched_documents = cursor.started ? TopDocuments(pageSize, cursor.last) : TopDocuments(pageSize);
+	page.documents = FindAllDocuments(*current, context, filter, std::move(matched_documents), timer);
+	page.stale = cursor.started && cursor.generation != current->GetGeneration();
+	page.next.generation = current->GetGeneration();
+	page.next.end = page.documents.size() < pageSize;
+	if(!page.documents.empty()){
+		page.next.last = page.documents.back();
+		page.next.started = true;
+	}
+	return page;
+}
+
+template <typename Predicat>
+std::vector<Document> SearchServer::FindAllDocuments(const IndexVersion& current, QueryContext& context, Predicat filter, TopDocuments matched_documents, StageTimer& timer)const{
+	// idf depends on the whole index, so it is computed before the segments are scored one by one
+	context.idfs.clear();
+	for(std::string_view word : context.query.plusWords){
+		context.idfs.push_back(current.GetIdf(word));
+	}
+	for(const auto& segment : current.GetSegments()){
+		context.plusTerms.clear();
+		for(std::size_t i = 0; i < context.query.plusWords.size(); ++i){
+			const int termId = segment->FindTerm(context.query.plusWords[i]);
+			if(termId != IndexSegment::NOT_FOUND && !segment->GetPostings(termId).empty()){
+				context.plusTerms.push_back({&segment->GetPostings(termId), context.idfs[i], segment->GetMaxTermFrequency(termId)});
 			}
 		}
-	}
-	for(std::string_view word : queryWords.minusWords){		
-		if(documents.find(static_cast<std::string>(word)) != documents.end()){
-			for(const auto& [documentId, documentTf]: documents.at(static_cast<std::string>(word))){
-				documentToRelevance.erase(documentId);
+		if(context.plusTerms.empty()){
+			timer.Mark(Metrics::Stage::TERM_LOOKUP);
+			continue;
+		}
+		context.minusPostings.clear();
+		for(std::string_view word : context.query.minusWords){
+			const PostingList* postings = segment->FindPostings(word);
+			if(postings != nullptr && !postings->empty()){
+				context.minusPostings.push_back(postings);
 			}
 		}
+		timer.Mark(Metrics::Stage::TERM_LOOKUP);
+		ScoreDocuments(*segment, context.plusTerms, context.minusPostings, filter, matched_documents, timer);
 	}
-	for(const auto& [id, relevance]: documentToRelevance){
-		matched_documents.push_back({id, relevance, documentsRatingStatus.at(id).rating});
-	}
-	return matched_documents;
+	std::vector<Document> result = matched_documents.Extract();
+	timer.Mark(Metrics::Stage::TOP_K);
+	return result;
 }
 
-
 template <typename Predicat>
-std::vector<Document> SearchServer::FindAllDocumentsParallel(const Query& queryWords, Predicat filter)const {
-	std::vector<Document> matched_documents;
-	matched_documents.reserve(documents.size());
-	std::map<int, double> documentToRelevance;
-
-	int thread_count = 8;
-	
-	ConcurrentMap<int, double> cm(thread_count);
-
-	auto relevanceHandler = [&](std::vector<std::string_view>::const_iterator begin, std::vector<std::string_view>::const_iterator end) {
-		std::for_each(begin, end, [&](std::string_view word) {
-			if (documents.find(static_cast<std::string>(word)) != documents.end()) {
-				double idf = log(GetDocumentCount() * 1.0 / documents.at(static_cast<std::string>(word)).size());
-				for (const auto& [documentId, documentTf] : documents.at(static_cast<std::string>(word))) {
-					if (filter(documentId, documentsRatingStatus.at(documentId).status, documentsRatingStatus.at(documentId).rating)) {
-						double tdIdf = idf * documentTf;
-						cm[documentId].tdIdf += tdIdf;
-					}
-				}
+void SearchServer::ScoreDocuments(const IndexSegment& segment, const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings, Predicat filter, TopDocuments& matched_documents, StageTimer& timer)const{
+	Metrics::Increment(Metrics::Counter::SEGMENTS_SCORED);
+	if(scoringMode == ScoringMode::MAX_SCORE){
+		// minus words and the heap are checked per candidate here, so the whole pass counts as scoring
+		MaxScoreEvaluator::ForCurrentThread().Score(segment, plusTerms, minusPostings, filter, matched_documents);
+		timer.Mark(Metrics::Stage::SCORING);
+		return;
+	}
+	ScoreAccumulator& documentToRelevance = ScoreAccumulator::ForCurrentThread();
+	documentToRelevance.Reset(segment.GetSize());
+	for(const auto& [postings, idf, maxTermFrequency] : plusTerms){
+		postings->ForEach([&, idf = idf](int documentIndex, uint32_t count){
+			if(AcceptsDocument(segment, documentIndex, filter)){
+				double tdIdf = idf * count * segment.GetInverseLength(documentIndex);
+				documentToRelevance.Add(documentIndex, tdIdf);
 			}
 		});
-	};
-
-	auto beginW = queryWords.plusWords.begin();
-	auto endW = queryWords.plusWords.end();
-	auto middleLeftW = beginW;
-	std::vector<std::future<void>> relevanceFutures;
-	for (int i = thread_count; i > 0; --i){
-		if (i < thread_count) {
-			beginW = middleLeftW;
+	}
+	timer.Mark(Metrics::Stage::SCORING);
+	// short minus lists are decoded, long ones are probed through their skip entries
+	const std::size_t touchedCount = documentToRelevance.GetTouchedCount();
+	for(const PostingList* postings : minusPostings){
+		if(postings->size() <= touchedCount){
+			postings->ForEach([&](int documentIndex, uint32_t){
+				documentToRelevance.Erase(documentIndex);
+			});
 		}
-
-		if (i == 1){
-			middleLeftW = endW;
-		}else {
-			middleLeftW = beginW + ((endW - middleLeftW) / i);
-		}		
-		relevanceFutures.push_back(std::async(relevanceHandler, beginW, middleLeftW));
 	}
+	timer.Mark(Metrics::Stage::MINUS_EXCLUSION);
+	documentToRelevance.ForEach([&](int documentIndex, double relevance){
+		for(const PostingList* postings : minusPostings){
+			if(postings->size() > touchedCount && postings->Contains(documentIndex)){
+				return;
+			}
+		}
+		matched_documents.Push({segment.GetDocumentId(documentIndex), relevance, segment.GetRating(documentIndex)});
+	});
+	timer.Mark(Metrics::Stage::TOP_K);
+}
 
-	for (std::future<void>& relevanceResult : relevanceFutures) {
-		relevanceResult.get();
+template <typename Predicat>
+std::vector<Document> SearchServer::FindAllDocumentsParallel(const IndexVersion& current, const ParsedQuery& queryWords, Predicat filter, std::size_t topCount, StageTimer& timer)const {
+	const auto& segments = current.GetSegments();
+
+	// minus words are resolved once into bitsets shared read-only by all workers
+	std::vector<std::vector<bool>> excluded(segments.size());
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		excluded[i].resize(segments[i]->GetSize());
+		for (std::string_view word : queryWords.minusWords) {
+			const PostingList* postings = segments[i]->FindPostings(word);
+			if (postings != nullptr) {
+				postings->ForEach([&](int documentIndex, uint32_t) {
+					excluded[i][documentIndex] = true;
+				});
+			}
+		}
+	}
+	timer.Mark(Metrics::Stage::MINUS_EXCLUSION);
+
+	// plus terms of every segment, in the order of segments
+	std::vector<std::vector<QueryTerm>> plusTerms(segments.size());
+	for (std::string_view word : queryWords.plusWords) {
+		const double idf = current.GetIdf(word);
+		for (std::size_t i = 0; i < segments.size(); ++i) {
+			const int termId = segments[i]->FindTerm(word);
+			if (termId != IndexSegment::NOT_FOUND && !segments[i]->GetPostings(termId).empty()) {
+				plusTerms[i].push_back({ &segments[i]->GetPostings(termId), idf, segments[i]->GetMaxTermFrequency(termId) });
+			}
+		}
+	}
+	timer.Mark(Metrics::Stage::TERM_LOOKUP);
+
+	// large segments are split into ranges, small ones are scored whole;
+	// the calling thread scores a range as well, hence one range more than pool threads
+	struct Range {
+		std::size_t segment;
+		int begin;
+		int end;
+	};
+	const int documentCount = static_cast<int>(current.GetSize());
+	const int rangeCount = std::max(1, std::min(static_cast<int>(threadPool->GetThreadCount()) + 1, documentCount / MIN_DOCUMENTS_PER_THREAD));
+	const int rangeSize = documentCount / rangeCount + 1;
+	std::vector<Range> ranges;
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		if (!plusTerms[i].empty()) {
+			Metrics::Increment(Metrics::Counter::SEGMENTS_SCORED);
+		}
+		for (int begin = 0; !plusTerms[i].empty() && begin < segments[i]->GetSize(); begin += rangeSize) {
+			ranges.push_back({ i, begin, std::min(segments[i]->GetSize(), begin + rangeSize) });
+		}
 	}
 
-	auto& documentsList = cm.BuildOrdinaryMap();
-
-	std::for_each(queryWords.minusWords.begin(), queryWords.minusWords.end(), [&](std::string_view word) {
-		if (documents.find(static_cast<std::string>(word)) != documents.end()) {
-			std::for_each(documents.at(static_cast<std::string>(word)).begin(), documents.at(static_cast<std::string>(word)).end(), [&](const auto& docInner) {
-				std::for_each(documentsList.begin(), documentsList.end(), [&](auto& item) {
-					std::lock_guard g(item.mutex);
-					item.data.erase(docInner.first);
-				});
+	// every worker scores its own range of document indexes, so no state is shared for writing
+	std::vector<TopDocuments> rangeTops(ranges.size(), TopDocuments(topCount));
+	threadPool->ParallelFor(ranges.size(), [&](std::size_t rangeIndex) {
+		const auto [i, begin, end] = ranges[rangeIndex];
+		const IndexSegment& segment = *segments[i];
+		ScoreAccumulator& documentToRelevance = ScoreAccumulator::ForCurrentThread();
+		documentToRelevance.Reset(end - begin);
+		for (const auto& [postings, idf, maxTermFrequency] : plusTerms[i]) {
+			// skip entries let each worker decode only the blocks overlapping its range
+			postings->ForEachInRange(begin, end, [&, idf = idf](int documentIndex, uint32_t count) {
+				if (!excluded[i][documentIndex] && AcceptsDocument(segment, documentIndex, filter)) {
+					documentToRelevance.Add(documentIndex - begin, idf * count * segment.GetInverseLength(documentIndex));
+				}
 			});
 		}
+		documentToRelevance.ForEach([&](int offset, double relevance) {
+			rangeTops[rangeIndex].Push({ segment.GetDocumentId(begin + offset), relevance, segment.GetRating(begin + offset) });
+		});
 	});
+	timer.Mark(Metrics::Stage::SCORING);
 
-
-	for (auto& item : documentsList) {
-		std::for_each(item.data.begin(), item.data.end(), [&](const auto& itemInner) {
-			Document* destination;
-			{
-				std::lock_guard guard(item.mutex);
-				destination = &matched_documents.emplace_back();
-			}
-			*destination = { itemInner.first, itemInner.second, documentsRatingStatus.at(itemInner.first).rating };
-		});		
+	TopDocuments matched_documents(topCount);
+	for (const TopDocuments& rangeTop : rangeTops) {
+		matched_documents.Merge(rangeTop);
 	}
-	
-	return matched_documents;
+	std::vector<Document> result = matched_documents.Extract();
+	timer.Mark(Metrics::Stage::TOP_K);
+	return result;
 }
 
 template<typename Execution>
-void SearchServer::RemoveDocument(Execution&& _Ex, int documentId) {
-	if (documentsIds.count(documentId) > 0) {
-		const auto wordFreqPointer = &(wordFreq[documentId]);
-		std::vector<const std::string*> words(wordFreqPointer->size());
-		std::transform(_Ex, wordFreqPointer->begin(), wordFreqPointer->end(), words.begin(), [&](const auto& pair) {
-			return &(pair.first);
-		});
-		std::for_each(_Ex, words.begin(), words.end(), [&](const std::string* word) {
-			if (documents.at(*word).count(documentId) > 0) {
-				documents.at(*word).erase(documentId);
-			}
-		});
-		documentsIds.erase(documentId);
-	}
+void SearchServer::RemoveDocument(Execution&&, int documentId) {
+	// marking a tombstone leaves nothing to parallelize
+	RemoveDocument(documentId);
 }
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "index_segment.h"
+#include "index_version.h"
+#include "merge_policy.h"
+#include "term_statistics.h"
+
+// Owner of the published IndexVersion. Writers take the write lock, derive the next
+// list of segments from the current version and publish it; merges chosen by the
+// MergePolicy run on a background thread and are published the same way.
+class SegmentedIndex {
+public:
+	struct Statistics {
+		std::size_t merges;
+		// documents written into merged segments
+		std::size_t mergedDocuments;
+		// removed documents the merges dropped
+		std::size_t droppedDocuments;
+		// heap bytes of the replaced segments less those of the merged ones; freed once
+		// no search holds the old version any more
+		std::size_t reclaimedBytes;
+	};
+
+	explicit SegmentedIndex(MergePolicy policy = MergePolicy());
+	SegmentedIndex(const SegmentedIndex&) = delete;
+	SegmentedIndex& operator=(const SegmentedIndex&) = delete;
+	// waits for a running merge
+	~SegmentedIndex();
+
+	std::shared_ptr<const IndexVersion> GetVersion()const;
+	// held by a writer from reading the version it changes until it publishes
+	std::unique_lock<std::mutex> LockWrites();
+	// publishes the segments as the next version and merges or schedules what the
+	// policy asks for; the write lock must be held. termStatistics describes the
+	// documents of the segments, the writer derives it from the current version
+	void Publish(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics);
+
+	void SetMergePolicy(const MergePolicy& policy);
+	MergePolicy GetMergePolicy()const;
+	// runs the merges the policy asks for on the calling thread
+	void Merge();
+	// rewrites every segment holding removed documents on the calling thread and
+	// rebuilds the term statistics without the terms left behind; returns the
+	// statistics of this pass alone
+	Statistics Compact();
+	Statistics GetStatistics()const;
+private:
+	// only accessed through std::atomic_load and std::atomic_store
+	std::shared_ptr<const IndexVersion> version = std::make_shared<IndexVersion>(std::vector<std::shared_ptr<const IndexSegment>>{}, std::make_shared<TermStatistics>(), 0);
+	// guards the fields below as well as publishing
+	mutable std::mutex writeMutex;
+	MergePolicy policy;
+	Statistics statistics{ 0, 0, 0, 0 };
+
+	std::thread mergeThread;
+	std::condition_variable mergeWanted;
+	bool mergePending = false;
+	std::atomic<bool> stopping = false;
+
+	// publishes the next generation for writers; merges leave the documents as they are and
+	// keep the current generation, and the term statistics except for Compact
+	void PublishVersion(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics, bool documentsChanged);
+	// the methods below change segments in place and need the write lock
+	// runs every merge the policy asks for, false when there was none
+	bool MergeAll(std::vector<std::shared_ptr<const IndexSegment>>& segments);
+	void MergeSegments(std::vector<std::shared_ptr<const IndexSegment>>& segments, const std::vector<std::size_t>& positions);
+	// puts merged in place of the first of the positions and drops the others
+	void ReplaceSegments(std::vector<std::shared_ptr<const IndexSegment>>& segments, const std::vector<std::size_t>& positions, std::shared_ptr<const IndexSegment> merged);
+	void RunMerges();
+	// one background merge; false when the policy finds nothing to merge
+	bool MergeInBackground();
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary snapshot of a SearchServer. The file starts with a SnapshotHeader and
+// continues with 8-byte aligned sections. Fixed-size records are stored in
+// their in-memory layout so a mapped file can be used without parsing.
+const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P' };
+const uint32_t SNAPSHOT_VERSION = 3;
+const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+
+enum class SnapshotSection : uint32_t {
+	STOP_WORDS,
+	TERMS,
+	POSTING_OFFSETS,
+	POSTINGS,
+	DOCUMENTS,
+	// forward index and max term frequencies of the segment, see IndexSegment::GetForwardIndex
+	FORWARD_OFFSETS,
+	FORWARD_ENTRIES,
+	MAX_TERM_FREQUENCIES,
+	// uint32_t per term
+	DOCUMENT_FREQUENCIES,
+	COUNT
+};
+
+struct SnapshotSectionEntry {
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct SnapshotHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;
+	uint64_t fileSize;
+	// FNV-1a over the 64-bit words that follow the header
+	uint64_t checksum;
+	SnapshotSectionEntry sections[static_cast<std::size_t>(SnapshotSection::COUNT)];
+};
+
+struct SnapshotDocument {
+	int32_t id;
+	int32_t rating;
+	int32_t status;
+	int32_t alive;
+	uint32_t length;
+};
+
+// Writes a snapshot to a file of its own next to path and renames it over path in Finish,
+// so readers, concurrent saves and mappings of the old file never see a partial one; an
+// unfinished file is removed.
+class SnapshotWriter {
+public:
+	explicit SnapshotWriter(const std::string& path);
+	~SnapshotWriter();
+	SnapshotWriter(const SnapshotWriter&) = delete;
+	SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+	void BeginSection(SnapshotSection section);
+	void Write(const void* data, std::size_t size);
+	// string table: count, count + 1 offsets into the character blob, the blob
+	void WriteStrings(const std::vector<std::string_view>& strings);
+	void EndSection();
+	void Finish();
+private:
+	std::string path;
+	std::string temporaryPath;
+	std::ofstream out;
+	bool finished = false;
+	SnapshotHeader header;
+	uint64_t position;
+	uint64_t checksum;
+	// bytes written since the last whole word, checksummed once it is complete
+	char partialWord[8];
+	std::size_t partialSize = 0;
+	SnapshotSection currentSection = SnapshotSection::COUNT;
+};
+
+// Maps a snapshot file read-only and validates it; sections stay valid while the reader lives,
+// so data served from them in place shares ownership of the reader.
+class SnapshotReader {
+public:
+	explicit SnapshotReader(const std::string& path);
+	~SnapshotReader();
+	SnapshotReader(const SnapshotReader&) = delete;
+	SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+	std::string_view GetSection(SnapshotSection section)const;
+	static std::vector<std::string_view> ReadStrings(std::string_view section);
+private:
+	const char* data = nullptr;
+	std::size_t size = 0;
+	// fallback storage where memory mapping is not available
+	std::vector<char> buffer;
+	SnapshotHeader header;
+};
@@ -4,4 +4,23 @@
 #include <string_view>
 #include <vector>
 
+enum class TokenizerImplementation {
+	SCALAR,
+	SSE2,
+	AVX2,
+};
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Splits text on spaces in a single pass, appending views into text to words.
+// Returns the position of the first byte below 32, or npos when there is none;
+// the text is split completely either way.
+std::size_t Tokenize(std::string_view text, std::vector<std::string_view>& words);
+std::size_t Tokenize(std::string_view text, std::vector<std::string_view>& words, TokenizerImplementation implementation);
+// position of the first byte below 32, or npos
+std::size_t FindControlCharacter(std::string_view text);
+
+// the fastest implementation supported by the running CPU
+TokenizerImplementation GetTokenizerImplementation();
+bool IsTokenizerSupported(TokenizerImplementation implementation);
+const char* GetTokenizerName(TokenizerImplementation implementation);
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Interns every term once into a stable arena and maps it to a dense id.
+// Views returned by the dictionary stay valid for its whole lifetime.
+class TermDictionary {
+public:
+	static const int NOT_FOUND = -1;
+
+	int Intern(std::string_view term);
+	int Find(std::string_view term)const;
+	std::string_view GetTerm(int termId)const;
+	std::size_t Size()const;
+	// approximate heap bytes held by the dictionary
+	std::size_t GetMemoryUsage()const;
+private:
+	// blocks double from the first size up to the last, so small segments stay small
+	static constexpr std::size_t FIRST_ARENA_BLOCK_SIZE = 256;
+	static constexpr std::size_t ARENA_BLOCK_SIZE = 64 * 1024;
+	std::vector<std::unique_ptr<char[]>> arena;
+	std::size_t arenaBlockSize = 0;
+	std::size_t arenaBlockUsed = 0;
+	std::size_t arenaBytes = 0;
+	std::vector<std::string_view> terms;
+	std::unordered_map<std::string_view, int> termIds;
+	std::string_view Store(std::string_view term);
+};
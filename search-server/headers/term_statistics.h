@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "index_segment.h"
+#include "term_dictionary.h"
+
+// Document frequency of every term over all segments together with its logarithm,
+// so a query gets idf = log(documents) - log(df) from one lookup and a subtraction.
+// A published table never changes: Update copies the shards holding changed terms
+// and shares the others, so a writer pays for the terms it touched only. The text of
+// dropped terms stays in the dictionary until dead terms outnumber the live ones;
+// Update then copies the live terms into a new dictionary and every shard with them.
+class TermStatistics {
+public:
+	struct Entry {
+		std::string_view term;
+		uint32_t documentFrequency;
+		double logDocumentFrequency;
+	};
+	// term and the change of its document frequency; a term may occur several times
+	using Changes = std::vector<std::pair<std::string_view, int>>;
+
+	TermStatistics();
+
+	// statistics of the documents of the segments that have not been removed
+	static std::shared_ptr<const TermStatistics> Build(const std::vector<std::shared_ptr<const IndexSegment>>& segments);
+	// table of distinct terms and their document frequencies, as a snapshot stores them;
+	// the terms are not copied but read from memory that storage keeps alive
+	static std::shared_ptr<const TermStatistics> Build(const std::vector<std::string_view>& terms, const uint32_t* documentFrequencies, std::shared_ptr<const void> storage);
+	// copy with the changes applied; terms whose frequency drops to 0 are dropped
+	std::shared_ptr<const TermStatistics> Update(const Changes& changes)const;
+
+	uint32_t GetDocumentFrequency(std::string_view term)const;
+	// 0 for terms no document has, like the idf of a word outside the index
+	double GetIdf(std::string_view term, double logDocumentCount)const;
+	std::size_t GetTermCount()const;
+	std::size_t GetMemoryUsage()const;
+private:
+	static constexpr std::size_t SHARD_COUNT = 1024;
+	// smaller dictionaries are not rebuilt, whatever their share of dead terms
+	static constexpr std::size_t MIN_DEAD_TERMS = 4096;
+	// sorted by term
+	using Shard = std::vector<Entry>;
+	// stores the text of the terms for every table derived from the same Build or rebuild;
+	// only writers add to it and entries keep pointing to it, so it is shared between tables
+	std::shared_ptr<TermDictionary> terms;
+	std::vector<std::shared_ptr<const Shard>> shards;
+	std::size_t termCount = 0;
+	// holds the text of the terms a snapshot restored, until the dictionary is rebuilt
+	std::shared_ptr<const void> storage;
+	std::size_t storedTermCount = 0;
+	// heap bytes of terms when this table was made; later tables add to the dictionary
+	// while readers of this one may ask for its size, so it is not read again
+	std::size_t termsMemoryUsage = 0;
+
+	const Entry* Find(std::string_view term)const;
+	// moves the live terms into a dictionary of their own
+	void RebuildTerms();
+	static std::size_t GetShard(std::string_view term);
+};
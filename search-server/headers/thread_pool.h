@@ -0,0 +1,117 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Persistent work-stealing executor. Every worker owns a deque: it takes its own
+// tasks from the back and steals from the front of the other deques when idle.
+class ThreadPool {
+public:
+	struct Statistics {
+		uint64_t tasksRun;
+		uint64_t steals;
+		std::chrono::nanoseconds idleTime;
+	};
+
+	explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// process-wide pool sized to the hardware, used when nothing else is injected
+	static std::shared_ptr<ThreadPool> GetDefault();
+
+	std::size_t GetThreadCount()const;
+	Statistics GetStatistics()const;
+
+	template <typename Function>
+	std::future<std::invoke_result_t<Function>> Submit(Function function);
+
+	// calls function(i) for every i in [0, count); the calling thread takes part
+	// and keeps running queued tasks while it waits, so nested calls cannot deadlock
+	template <typename Function>
+	void ParallelFor(std::size_t count, Function function);
+private:
+	using Task = std::function<void()>;
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> threads;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	bool stopping = false;
+	std::atomic<std::size_t> pendingTasks{ 0 };
+	std::atomic<std::size_t> nextQueue{ 0 };
+	std::atomic<uint64_t> tasksRun{ 0 };
+	std::atomic<uint64_t> steals{ 0 };
+	std::atomic<uint64_t> idleNanoseconds{ 0 };
+
+	void Push(Task task);
+	// runs one queued task if there is any, preferring the caller's own deque
+	bool TryRunTask();
+	void WorkerLoop(std::size_t queueIndex);
+	std::size_t GetOwnQueue()const;
+};
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::Submit(Function function) {
+	using Result = std::invoke_result_t<Function>;
+	auto task = std::make_shared<std::packaged_task<Result()>>(std::move(function));
+	std::future<Result> result = task->get_future();
+	Push([task] { (*task)(); });
+	return result;
+}
+
+template <typename Function>
+void ThreadPool::ParallelFor(std::size_t count, Function function) {
+	if (count == 0) {
+		return;
+	}
+	std::atomic<std::size_t> nextItem{ 0 };
+	std::atomic<std::size_t> finishedHelpers{ 0 };
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	auto runItems = [&] {
+		for (std::size_t item = nextItem++; item < count; item = nextItem++) {
+			try {
+				function(item);
+			}
+			catch (...) {
+				std::lock_guard guard(errorMutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+		}
+	};
+
+	const std::size_t helperCount = std::min(count, queues.size() + 1) - 1;
+	for (std::size_t i = 0; i < helperCount; ++i) {
+		Push([&] {
+			runItems();
+			++finishedHelpers;
+		});
+	}
+	runItems();
+	while (finishedHelpers < helperCount) {
+		if (!TryRunTask()) {
+			std::this_thread::yield();
+		}
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+
+const double EPSILON = 1e-6;
+
+// Bounded collector of the best documents: higher relevance first, and among
+// documents whose relevance differs by less than EPSILON the higher rating wins;
+// full ties go to the lower id so that the selection does not depend on input order.
+class TopDocuments {
+public:
+	explicit TopDocuments(std::size_t capacity);
+	// collects only the documents ranked after `after`, the last one of a previous page
+	TopDocuments(std::size_t capacity, const Document& after);
+
+	void Push(const Document& document);
+	void Merge(const TopDocuments& other);
+	// documents whose relevance is below this cannot enter; -infinity while there is room
+	double GetEntryThreshold()const;
+	// returns the collected documents from best to worst and leaves the collector empty
+	std::vector<Document> Extract();
+
+	static bool IsBetter(const Document& lhs, const Document& rhs);
+private:
+	std::size_t capacity;
+	bool hasAfter = false;
+	Document after;
+	// heap ordered by IsBetter, so the worst kept document sits at the front
+	std::vector<Document> heap;
+};
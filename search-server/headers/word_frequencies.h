@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "term_dictionary.h"
+
+// one word of a document in the forward index
+struct ForwardEntry {
+	int termId;
+	uint32_t count;
+};
+
+// View of the words of one document with their term frequencies, ordered by the
+// term ids of the segment holding the document. The view shares ownership of the
+// segment's dictionary and forward index, so it and its iterators stay valid after
+// the index moves on and the segment is merged away; iterating it does not allocate.
+class WordFrequencies {
+public:
+	class Iterator {
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<std::string_view, double>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		Iterator(const TermDictionary* dictionary, const ForwardEntry* entry, double inverseLength);
+		value_type operator*()const;
+		Iterator& operator++();
+		bool operator==(const Iterator& other)const;
+		bool operator!=(const Iterator& other)const;
+	private:
+		const TermDictionary* dictionary;
+		const ForwardEntry* entry;
+		double inverseLength;
+	};
+
+	WordFrequencies() = default;
+	// owner keeps dictionary and the entries alive
+	WordFrequencies(std::shared_ptr<const void> owner, const TermDictionary& dictionary, const ForwardEntry* first, const ForwardEntry* last, double inverseLength);
+
+	Iterator begin()const;
+	Iterator end()const;
+	std::size_t size()const;
+	bool empty()const;
+	// term frequency of the word, 0 when the document does not have it
+	double GetFrequency(std::string_view word)const;
+	// the entries themselves, term ids are only comparable within one segment
+	const ForwardEntry* GetEntries()const;
+private:
+	std::shared_ptr<const void> owner;
+	const TermDictionary* dictionary = nullptr;
+	const ForwardEntry* first = nullptr;
+	const ForwardEntry* last = nullptr;
+	double inverseLength = 0.0;
+};
@@ -0,0 +1,24 @@
+#include "headers/index_builder.h"
+
+IndexBuilder::IndexBuilder(SearchServer& searchServer) :search(searchServer) {}
+
+IndexBuilder& IndexBuilder::Add(int documentId, std::string document, DocumentStatus status, std::vector<int> ratings) {
+	pending.push_back({ documentId, std::move(document), status, std::move(ratings) });
+	return *this;
+}
+
+std::size_t IndexBuilder::GetPendingCount()const {
+	return pending.size();
+}
+
+IndexingStatistics IndexBuilder::Build() {
+	std::vector<DocumentInput> batch;
+	batch.reserve(pending.size());
+	// the ratings are copied: a batch that throws leaves the builder as it was, ready to retry
+	for (const PendingDocument& document : pending) {
+		batch.push_back({ document.id, document.text, document.status, document.ratings });
+	}
+	IndexingStatistics statistics = search.AddDocuments(batch);
+	pending.clear();
+	return statistics;
+}
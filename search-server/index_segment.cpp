@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <stdexcept>
+#include "headers/index_segment.h"
+
+int IndexSegment::AddDocument(int documentId, int rating, DocumentStatus status, uint32_t length) {
+	const int documentIndex = GetSize();
+	content->ids.push_back(documentId);
+	content->ratings.push_back(rating);
+	content->statuses.push_back(status);
+	content->lengths.push_back(length);
+	content->inverseLengths.push_back(length > 0 ? 1.0 / length : 0.0);
+	content->indexes[documentId] = documentIndex;
+	if (documentIndex % 64 == 0) {
+		tombstones->bits.push_back(0);
+		for (std::vector<uint64_t>& bits : content->statusBits) {
+			bits.push_back(0);
+		}
+	}
+	content->statusBits[static_cast<std::size_t>(status)].back() |= uint64_t{ 1 } << (documentIndex & 63);
+	return documentIndex;
+}
+
+void IndexSegment::AddPosting(std::string_view term, int documentIndex, uint32_t count) {
+	const int termId = AddTerm(term);
+	postings[termId]->Append(documentIndex, count);
+}
+
+void IndexSegment::AddPostings(std::string_view term, const std::vector<Posting>& list) {
+	const int termId = AddTerm(term);
+	for (const Posting& posting : list) {
+		postings[termId]->Append(posting.documentIndex, posting.count);
+	}
+}
+
+void IndexSegment::AddPostings(std::string_view term, PostingList list) {
+	*postings[AddTerm(term)] = std::move(list);
+}
+
+void IndexSegment::Seal() {
+	// counting sort of the postings by document; visiting the terms in id order
+	// leaves every document's entries sorted by term id
+	std::vector<uint32_t>& offsets = content->forwardOffsets;
+	offsets.assign(GetSize() + 1, 0);
+	for (const auto& list : postings) {
+		list->ForEach([&](int documentIndex, uint32_t) {
+			++offsets[documentIndex + 1];
+		});
+	}
+	for (std::size_t i = 1; i < offsets.size(); ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+	content->forwardEntries.resize(offsets.back());
+	content->maxTermFrequencies.assign(postings.size(), 0.0);
+	std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+	for (std::size_t termId = 0; termId < postings.size(); ++termId) {
+		double& maxTermFrequency = content->maxTermFrequencies[termId];
+		postings[termId]->ForEach([&](int documentIndex, uint32_t count) {
+			content->forwardEntries[next[documentIndex]++] = { static_cast<int>(termId), count };
+			maxTermFrequency = std::max(maxTermFrequency, count * content->inverseLengths[documentIndex]);
+		});
+	}
+	content->forwardOffsetData = offsets.data();
+	content->forwardEntryData = content->forwardEntries.data();
+	content->maxTermFrequencyData = content->maxTermFrequencies.data();
+}
+
+IndexSegment::ForwardIndex IndexSegment::GetForwardIndex()const {
+	const std::size_t entryCount = content->forwardOffsetData[GetSize()];
+	return {
+		{ reinterpret_cast<const char*>(content->forwardOffsetData), (GetSize() + 1) * sizeof(uint32_t) },
+		{ reinterpret_cast<const char*>(content->forwardEntryData), entryCount * sizeof(ForwardEntry) },
+		{ reinterpret_cast<const char*>(content->maxTermFrequencyData), postings.size() * sizeof(double) }
+	};
+}
+
+void IndexSegment::Seal(const ForwardIndex& forwardIndex, std::shared_ptr<const void> storage) {
+	if (forwardIndex.offsets.size() != (GetSize() + 1) * sizeof(uint32_t) || forwardIndex.entries.size() % sizeof(ForwardEntry) != 0
+		|| forwardIndex.maxTermFrequencies.size() != postings.size() * sizeof(double)) {
+		throw std::runtime_error("forward index does not match the segment");
+	}
+	const auto* offsets = reinterpret_cast<const uint32_t*>(forwardIndex.offsets.data());
+	for (int documentIndex = 0; documentIndex < GetSize(); ++documentIndex) {
+		if (offsets[documentIndex] > offsets[documentIndex + 1]) {
+			throw std::runtime_error("forward index offsets are not sorted");
+		}
+	}
+	if (offsets[0] != 0 || offsets[GetSize()] != forwardIndex.entries.size() / sizeof(ForwardEntry)) {
+		throw std::runtime_error("forward index offsets are out of bounds");
+	}
+	content->forwardOffsetData = offsets;
+	content->forwardEntryData = reinterpret_cast<const ForwardEntry*>(forwardIndex.entries.data());
+	content->maxTermFrequencyData = reinterpret_cast<const double*>(forwardIndex.maxTermFrequencies.data());
+	content->forwardStorage = std::move(storage);
+}
+
+void IndexSegment::MarkRemoved(int documentIndex) {
+	MarkRemoved(*tombstones, documentIndex);
+}
+
+std::shared_ptr<IndexSegment> IndexSegment::RemoveDocument(int documentIndex)const {
+	auto segment = std::make_shared<IndexSegment>(*this);
+	segment->tombstones = std::make_shared<Tombstones>(*tombstones);
+	MarkRemoved(*segment->tombstones, documentIndex);
+	return segment;
+}
+
+std::shared_ptr<IndexSegment> IndexSegment::Merge(const std::vector<std::shared_ptr<const IndexSegment>>& segments) {
+	auto merged = std::make_shared<IndexSegment>();
+	// new index of every document of every segment, NOT_FOUND for removed ones
+	std::vector<std::vector<int>> newIndexes(segments.size());
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		const IndexSegment& segment = *segments[i];
+		newIndexes[i].resize(segment.GetSize(), NOT_FOUND);
+		for (int documentIndex = 0; documentIndex < segment.GetSize(); ++documentIndex) {
+			if (!segment.IsRemoved(documentIndex)) {
+				newIndexes[i][documentIndex] = merged->AddDocument(segment.GetDocumentId(documentIndex), segment.GetRating(documentIndex), segment.GetStatus(documentIndex), segment.GetLength(documentIndex));
+			}
+		}
+	}
+	// segments are renumbered in order, so appending them one after another keeps every list sorted;
+	// terms left without postings are not carried over
+	std::vector<Posting> list;
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		const IndexSegment& segment = *segments[i];
+		for (std::size_t termId = 0; termId < segment.GetTermCount(); ++termId) {
+			list.clear();
+			segment.GetPostings(static_cast<int>(termId)).ForEach([&](int documentIndex, uint32_t count) {
+				if (newIndexes[i][documentIndex] != NOT_FOUND) {
+					list.push_back({ newIndexes[i][documentIndex], count });
+				}
+			});
+			if (!list.empty()) {
+				merged->AddPostings(segment.GetTerm(static_cast<int>(termId)), list);
+			}
+		}
+	}
+	merged->Seal();
+	return merged;
+}
+
+bool IndexSegment::IsVersionOf(const IndexSegment& other)const {
+	return content == other.content;
+}
+
+int IndexSegment::GetSize()const {
+	return static_cast<int>(content->ids.size());
+}
+
+std::size_t IndexSegment::GetDocumentCount()const {
+	return content->ids.size() - tombstones->count;
+}
+
+std::size_t IndexSegment::GetRemovedCount()const {
+	return tombstones->count;
+}
+
+int IndexSegment::FindDocument(int documentId)const {
+	auto it = content->indexes.find(documentId);
+	if (it == content->indexes.end()) {
+		return NOT_FOUND;
+	}
+	return it->second;
+}
+
+uint32_t IndexSegment::GetLength(int documentIndex)const {
+	return content->lengths[documentIndex];
+}
+
+WordFrequencies IndexSegment::GetWordFrequencies(int documentIndex)const {
+	const ForwardEntry* entries = content->forwardEntryData;
+	return { content, content->dictionary, entries + content->forwardOffsetData[documentIndex], entries + content->forwardOffsetData[documentIndex + 1], content->inverseLengths[documentIndex] };
+}
+
+std::size_t IndexSegment::GetTermCount()const {
+	return postings.size();
+}
+
+std::string_view IndexSegment::GetTerm(int termId)const {
+	return content->dictionary.GetTerm(termId);
+}
+
+int IndexSegment::FindTerm(std::string_view term)const {
+	const int termId = content->dictionary.Find(term);
+	return termId == TermDictionary::NOT_FOUND ? NOT_FOUND : termId;
+}
+
+const PostingList& IndexSegment::GetPostings(int termId)const {
+	return *postings[termId];
+}
+
+double IndexSegment::GetMaxTermFrequency(int termId)const {
+	return content->maxTermFrequencyData[termId];
+}
+
+const PostingList* IndexSegment::FindPostings(std::string_view term)const {
+	const int termId = content->dictionary.Find(term);
+	if (termId == TermDictionary::NOT_FOUND) {
+		return nullptr;
+	}
+	return postings[termId].get();
+}
+
+std::size_t IndexSegment::GetDocumentFrequency(std::string_view term)const {
+	const int termId = content->dictionary.Find(term);
+	if (termId == TermDictionary::NOT_FOUND) {
+		return 0;
+	}
+	const std::size_t removed = static_cast<std::size_t>(termId) < tombstones->postings.size() ? tombstones->postings[termId] : 0;
+	return postings[termId]->size() - removed;
+}
+
+double IndexSegment::Statistics::GetBytesPerPosting()const {
+	return postings > 0 ? static_cast<double>(postingBytes) / postings : 0.0;
+}
+
+IndexSegment::Statistics IndexSegment::GetStatistics()const {
+	Statistics statistics{ 1, postings.size(), 0, 0, tombstones->count, GetMemoryUsage() };
+	for (const auto& list : postings) {
+		statistics.postings += list->size();
+		statistics.postingBytes += list->GetMemoryUsage();
+	}
+	return statistics;
+}
+
+std::size_t IndexSegment::GetMemoryUsage()const {
+	std::size_t bytes = content->dictionary.GetMemoryUsage() + postings.capacity() * sizeof(std::shared_ptr<PostingList>);
+	for (const auto& list : postings) {
+		bytes += sizeof(PostingList) + list->GetMemoryUsage();
+	}
+	bytes += content->ids.capacity() * sizeof(int) + content->ratings.capacity() * sizeof(int) + content->statuses.capacity() * sizeof(DocumentStatus);
+	bytes += content->lengths.capacity() * sizeof(uint32_t) + content->inverseLengths.capacity() * sizeof(double);
+	bytes += content->forwardOffsets.capacity() * sizeof(uint32_t) + content->forwardEntries.capacity() * sizeof(ForwardEntry);
+	bytes += content->maxTermFrequencies.capacity() * sizeof(double);
+	for (const std::vector<uint64_t>& bits : content->statusBits) {
+		bytes += bits.capacity() * sizeof(uint64_t);
+	}
+	// hash nodes hold a link besides the entry
+	bytes += content->indexes.bucket_count() * sizeof(void*) + content->indexes.size() * (sizeof(std::pair<const int, int>) + sizeof(void*));
+	bytes += tombstones->bits.capacity() * sizeof(uint64_t) + tombstones->postings.capacity() * sizeof(uint32_t);
+	return bytes;
+}
+
+int IndexSegment::AddTerm(std::string_view term) {
+	const int termId = content->dictionary.Intern(term);
+	if (static_cast<std::size_t>(termId) == postings.size()) {
+		postings.push_back(std::make_shared<PostingList>());
+	}
+	return termId;
+}
+
+void IndexSegment::MarkRemoved(Tombstones& target, int documentIndex)const {
+	uint64_t& word = target.bits[documentIndex >> 6];
+	const uint64_t bit = uint64_t{ 1 } << (documentIndex & 63);
+	if ((word & bit) != 0) {
+		return;
+	}
+	word |= bit;
+	++target.count;
+	target.postings.resize(postings.size());
+	if (content->forwardOffsetData == nullptr) {
+		// a segment that is not sealed yet has no forward entries
+		return;
+	}
+	for (uint32_t entry = content->forwardOffsetData[documentIndex]; entry < content->forwardOffsetData[documentIndex + 1]; ++entry) {
+		++target.postings[content->forwardEntryData[entry].termId];
+	}
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include "headers/index_version.h"
+
+IndexVersion::IndexVersion(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics, uint64_t generation)
+	:segments(std::move(segments)), termStatistics(std::move(termStatistics)), generation(generation) {
+	for (const auto& segment : this->segments) {
+		documentCount += segment->GetDocumentCount();
+	}
+	// the only logarithm of the document count, every idf subtracts that of its frequency from it
+	logDocumentCount = documentCount > 0 ? std::log(static_cast<double>(documentCount)) : 0.0;
+}
+
+const std::vector<std::shared_ptr<const IndexSegment>>& IndexVersion::GetSegments()const {
+	return segments;
+}
+
+uint64_t IndexVersion::GetGeneration()const {
+	return generation;
+}
+
+std::size_t IndexVersion::GetDocumentCount()const {
+	return documentCount;
+}
+
+std::size_t IndexVersion::GetSize()const {
+	std::size_t size = 0;
+	for (const auto& segment : segments) {
+		size += segment->GetSize();
+	}
+	return size;
+}
+
+const IndexSegment* IndexVersion::FindDocument(int documentId, int& documentIndex)const {
+	for (const auto& segment : segments) {
+		documentIndex = segment->FindDocument(documentId);
+		// a removed id may have been added again to a later segment
+		if (documentIndex != IndexSegment::NOT_FOUND && !segment->IsRemoved(documentIndex)) {
+			return segment.get();
+		}
+	}
+	return nullptr;
+}
+
+std::size_t IndexVersion::GetDocumentFrequency(std::string_view term)const {
+	return termStatistics->GetDocumentFrequency(term);
+}
+
+double IndexVersion::GetIdf(std::string_view term)const {
+	return termStatistics->GetIdf(term, logDocumentCount);
+}
+
+const std::shared_ptr<const TermStatistics>& IndexVersion::GetTermStatistics()const {
+	return termStatistics;
+}
+
+const std::vector<int>& IndexVersion::GetDocumentIds()const {
+	std::call_once(documentIdsBuilt, [this] {
+		documentIds.reserve(documentCount);
+		for (const auto& segment : segments) {
+			for (int documentIndex = 0; documentIndex < segment->GetSize(); ++documentIndex) {
+				if (!segment->IsRemoved(documentIndex)) {
+					documentIds.push_back(segment->GetDocumentId(documentIndex));
+				}
+			}
+		}
+		std::sort(documentIds.begin(), documentIds.end());
+	});
+	return documentIds;
+}
+
+IndexSegment::Statistics IndexVersion::GetStatistics()const {
+	IndexSegment::Statistics statistics{ 0, 0, 0, 0, 0, 0 };
+	for (const auto& segment : segments) {
+		const IndexSegment::Statistics segmentStatistics = segment->GetStatistics();
+		statistics.segments += segmentStatistics.segments;
+		statistics.terms += segmentStatistics.terms;
+		statistics.postings += segmentStatistics.postings;
+		statistics.postingBytes += segmentStatistics.postingBytes;
+		statistics.removedDocuments += segmentStatistics.removedDocuments;
+		statistics.memoryBytes += segmentStatistics.memoryBytes;
+	}
+	statistics.memoryBytes += termStatistics->GetMemoryUsage();
+	return statistics;
+}
+
+WordFrequencies IndexVersion::GetWordFrequencies(int documentId)const {
+	int documentIndex = 0;
+	const IndexSegment* segment = FindDocument(documentId, documentIndex);
+	if (segment == nullptr) {
+		return {};
+	}
+	return segment->GetWordFrequencies(documentIndex);
+}
+
+DocumentIdRange::Iterator::Iterator(std::shared_ptr<const IndexVersion> version, std::size_t position)
+	:version(std::move(version)), ids(&this->version->GetDocumentIds()), position(position) {}
+
+const int& DocumentIdRange::Iterator::operator*()const {
+	return (*ids)[position];
+}
+
+DocumentIdRange::Iterator& DocumentIdRange::Iterator::operator++() {
+	++position;
+	return *this;
+}
+
+DocumentIdRange::Iterator DocumentIdRange::Iterator::operator++(int) {
+	Iterator previous = *this;
+	++position;
+	return previous;
+}
+
+bool DocumentIdRange::Iterator::operator==(const Iterator& other)const {
+	if (IsEnd() || other.IsEnd()) {
+		return IsEnd() && other.IsEnd();
+	}
+	return ids == other.ids && position == other.position;
+}
+
+bool DocumentIdRange::Iterator::operator!=(const Iterator& other)const {
+	return !(*this == other);
+}
+
+bool DocumentIdRange::Iterator::IsEnd()const {
+	return ids == nullptr || position == ids->size();
+}
+
+DocumentIdRange::DocumentIdRange(std::shared_ptr<const IndexVersion> version) :version(std::move(version)) {}
+
+DocumentIdRange::Iterator DocumentIdRange::begin()const {
+	return { version, 0 };
+}
+
+DocumentIdRange::Iterator DocumentIdRange::end()const {
+	return { version, version->GetDocumentIds().size() };
+}
+
+std::size_t DocumentIdRange::size()const {
+	return version->GetDocumentIds().size();
+}
+
+const IndexVersion& DocumentIdRange::GetVersion()const {
+	return *version;
+}
@@ -0,0 +1,9 @@
+#include "headers/indexing.h"
+
+double IndexingStatistics::GetDocumentsPerSecond()const {
+	return seconds > 0.0 ? documents / seconds : 0.0;
+}
+
+double IndexingStatistics::GetMegabytesPerSecond()const {
+	return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
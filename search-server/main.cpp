@@ -12,7 +12,6 @@
 #include "headers/remove_duplicates.h"
 #include "headers/request_queue.h"
 #include "headers/process_queries.h"
-#include "headers/test.h"
 
 
 using namespace std::string_literals;
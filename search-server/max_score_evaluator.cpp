@@ -0,0 +1,38 @@
+#include <numeric>
+#include "headers/max_score_evaluator.h"
+
+MaxScoreEvaluator& MaxScoreEvaluator::ForCurrentThread() {
+	static thread_local MaxScoreEvaluator evaluator;
+	return evaluator;
+}
+
+void MaxScoreEvaluator::Reset(const std::vector<QueryTerm>& plusTerms, const std::vector<const PostingList*>& minusPostings) {
+	cursors.clear();
+	bounds.clear();
+	for (const QueryTerm& term : plusTerms) {
+		cursors.emplace_back(*term.postings);
+		bounds.push_back(term.idf * term.maxTermFrequency);
+	}
+	contributions.resize(plusTerms.size());
+	matched.resize(plusTerms.size());
+	minusCursors.clear();
+	for (const PostingList* postings : minusPostings) {
+		minusCursors.emplace_back(*postings);
+	}
+
+	order.resize(plusTerms.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+		return bounds[lhs] < bounds[rhs];
+	});
+	boundSums.resize(plusTerms.size());
+	double sum = 0.0;
+	for (std::size_t k = 0; k < order.size(); ++k) {
+		sum += bounds[order[k]];
+		boundSums[k] = sum;
+	}
+}
+
+std::size_t MaxScoreEvaluator::CountNonEssential(double threshold)const {
+	return std::lower_bound(boundSums.begin(), boundSums.end(), threshold) - boundSums.begin();
+}
@@ -0,0 +1,43 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "headers/merge_policy.h"
+
+std::vector<std::size_t> MergePolicy::FindMerge(const std::vector<std::shared_ptr<const IndexSegment>>& segments)const {
+	const std::size_t mergeCount = std::max<std::size_t>(2, segmentsPerMerge);
+	const double tierBase = std::log(std::max(2.0, sizeRatio));
+	// the lowest full tier first, its segments are the cheapest to merge
+	std::map<int, std::vector<std::size_t>> tiers;
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		const double documentCount = static_cast<double>(std::max<std::size_t>(1, segments[i]->GetDocumentCount()));
+		tiers[static_cast<int>(std::log(documentCount) / tierBase)].push_back(i);
+	}
+	for (auto& [tier, positions] : tiers) {
+		if (positions.size() >= mergeCount) {
+			positions.resize(mergeCount);
+			return positions;
+		}
+	}
+	for (std::size_t i = 0; i < segments.size(); ++i) {
+		const IndexSegment& segment = *segments[i];
+		const std::size_t removed = segment.GetSize() - segment.GetDocumentCount();
+		if (removed > 0 && removed >= removedRatio * segment.GetSize()) {
+			return { i };
+		}
+	}
+	return {};
+}
+
+std::vector<std::size_t> MergePolicy::FindForcedMerge(const std::vector<std::shared_ptr<const IndexSegment>>& segments)const {
+	std::vector<std::size_t> positions(segments.size());
+	for (std::size_t i = 0; i < positions.size(); ++i) {
+		positions[i] = i;
+	}
+	const std::size_t mergeCount = std::min(segments.size(), std::max<std::size_t>(2, segmentsPerMerge));
+	std::partial_sort(positions.begin(), positions.begin() + mergeCount, positions.end(), [&](std::size_t lhs, std::size_t rhs) {
+		return segments[lhs]->GetSize() < segments[rhs]->GetSize();
+	});
+	positions.resize(mergeCount);
+	std::sort(positions.begin(), positions.end());
+	return positions;
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include "headers/metrics.h"
+
+namespace {
+	// blocks outlive their threads: a block is handed to the next new thread, and
+	// as only sums are reported its counts simply keep growing
+	class BlockRegistry {
+	public:
+		template <typename Block>
+		Block* Acquire() {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!freeBlocks.empty()) {
+				void* block = freeBlocks.back();
+				freeBlocks.pop_back();
+				return static_cast<Block*>(block);
+			}
+			auto block = std::make_shared<Block>();
+			blocks.push_back(block);
+			return block.get();
+		}
+
+		void Release(void* block) {
+			std::lock_guard<std::mutex> lock(mutex);
+			freeBlocks.push_back(block);
+		}
+
+		template <typename Block, typename Callback>
+		void ForEach(Callback callback) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (const auto& block : blocks) {
+				callback(*std::static_pointer_cast<Block>(block));
+			}
+		}
+	private:
+		std::mutex mutex;
+		std::vector<std::shared_ptr<void>> blocks;
+		std::vector<void*> freeBlocks;
+	};
+
+	BlockRegistry& GetRegistry() {
+		// never destroyed, threads may still release their blocks during static destruction
+		static BlockRegistry* registry = new BlockRegistry();
+		return *registry;
+	}
+
+	template <typename Block>
+	class BlockOwner {
+	public:
+		BlockOwner() :block(GetRegistry().Acquire<Block>()) {}
+		~BlockOwner() {
+			GetRegistry().Release(block);
+		}
+		Block& Get() {
+			return *block;
+		}
+	private:
+		Block* block;
+	};
+
+	int GetHighestBit(uint64_t value) {
+		int bit = 0;
+		while (value >>= 1) {
+			++bit;
+		}
+		return bit;
+	}
+}
+
+Metrics::Snapshot::Snapshot() {
+	for (std::vector<uint64_t>& stageBuckets : buckets) {
+		stageBuckets.assign(BUCKET_COUNT, 0);
+	}
+}
+
+uint64_t Metrics::Snapshot::GetCount(Stage stage)const {
+	const std::vector<uint64_t>& stageBuckets = buckets[static_cast<std::size_t>(stage)];
+	uint64_t count = 0;
+	for (uint64_t bucketCount : stageBuckets) {
+		count += bucketCount;
+	}
+	return count;
+}
+
+std::chrono::nanoseconds Metrics::Snapshot::GetTotal(Stage stage)const {
+	return std::chrono::nanoseconds(totals[static_cast<std::size_t>(stage)]);
+}
+
+std::chrono::nanoseconds Metrics::Snapshot::GetPercentile(Stage stage, double quantile)const {
+	const uint64_t count = GetCount(stage);
+	if (count == 0) {
+		return std::chrono::nanoseconds(0);
+	}
+	const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * count)));
+	const std::vector<uint64_t>& stageBuckets = buckets[static_cast<std::size_t>(stage)];
+	uint64_t seen = 0;
+	for (std::size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		seen += stageBuckets[bucket];
+		if (seen >= rank) {
+			return std::chrono::nanoseconds(GetBucketUpperBound(bucket));
+		}
+	}
+	return std::chrono::nanoseconds(GetBucketUpperBound(BUCKET_COUNT - 1));
+}
+
+uint64_t Metrics::Snapshot::GetCounter(Counter counter)const {
+	return counters[static_cast<std::size_t>(counter)];
+}
+
+Metrics::Snapshot Metrics::Snapshot::Since(const Snapshot& earlier)const {
+	Snapshot difference;
+	for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+		for (std::size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+			difference.buckets[stage][bucket] = buckets[stage][bucket] - earlier.buckets[stage][bucket];
+		}
+		difference.totals[stage] = totals[stage] - earlier.totals[stage];
+	}
+	for (std::size_t counter = 0; counter < COUNTER_COUNT; ++counter) {
+		difference.counters[counter] = counters[counter] - earlier.counters[counter];
+	}
+	return difference;
+}
+
+std::string Metrics::Snapshot::ToJson()const {
+	std::ostringstream out;
+	out << "{ \"stages\": {";
+	for (std::size_t i = 0; i < STAGE_COUNT; ++i) {
+		const Stage stage = static_cast<Stage>(i);
+		out << (i > 0 ? ", " : " ") << '"' << GetName(stage) << "\": { \"count\": " << GetCount(stage)
+			<< ", \"total_ns\": " << GetTotal(stage).count()
+			<< ", \"p50_ns\": " << GetPercentile(stage, 0.5).count()
+			<< ", \"p99_ns\": " << GetPercentile(stage, 0.99).count()
+			<< ", \"p999_ns\": " << GetPercentile(stage, 0.999).count() << " }";
+	}
+	out << " }, \"counters\": {";
+	for (std::size_t i = 0; i < COUNTER_COUNT; ++i) {
+		const Counter counter = static_cast<Counter>(i);
+		out << (i > 0 ? ", " : " ") << '"' << GetName(counter) << "\": " << GetCounter(counter);
+	}
+	out << " } }";
+	return out.str();
+}
+
+void Metrics::Record(Stage stage, std::chrono::nanoseconds duration) {
+	if constexpr (ENABLED) {
+		ThreadBlock& block = GetThreadBlock();
+		const uint64_t nanoseconds = static_cast<uint64_t>(std::max<int64_t>(0, duration.count()));
+		Add(block.buckets[static_cast<std::size_t>(stage)][GetBucket(nanoseconds)], 1);
+		Add(block.totals[static_cast<std::size_t>(stage)], nanoseconds);
+	}
+}
+
+Metrics::Snapshot Metrics::GetSnapshot() {
+	Snapshot snapshot;
+	GetRegistry().ForEach<ThreadBlock>([&](const ThreadBlock& block) {
+		for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+			for (std::size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+				snapshot.buckets[stage][bucket] += block.buckets[stage][bucket].load(std::memory_order_relaxed);
+			}
+			snapshot.totals[stage] += block.totals[stage].load(std::memory_order_relaxed);
+		}
+		for (std::size_t counter = 0; counter < COUNTER_COUNT; ++counter) {
+			snapshot.counters[counter] += block.counters[counter].load(std::memory_order_relaxed);
+		}
+	});
+	return snapshot;
+}
+
+const char* Metrics::GetName(Stage stage) {
+	static const char* const NAMES[] = { "query", "parse", "term_lookup", "scoring", "minus_exclusion", "top_k", "indexing", "tokenize", "build_segment", "publish" };
+	static_assert(std::size(NAMES) == STAGE_COUNT);
+	return NAMES[static_cast<std::size_t>(stage)];
+}
+
+const char* Metrics::GetName(Counter counter) {
+	static const char* const NAMES[] = { "queries", "parallel_queries", "batch_queries", "segments_scored", "documents_added", "documents_removed" };
+	static_assert(std::size(NAMES) == COUNTER_COUNT);
+	return NAMES[static_cast<std::size_t>(counter)];
+}
+
+std::size_t Metrics::GetBucket(uint64_t nanoseconds) {
+	constexpr uint64_t SUB_BUCKETS = uint64_t{ 1 } << SUB_BUCKET_BITS;
+	if (nanoseconds < SUB_BUCKETS) {
+		return static_cast<std::size_t>(nanoseconds);
+	}
+	const int shift = GetHighestBit(nanoseconds) - SUB_BUCKET_BITS;
+	const std::size_t bucket = static_cast<std::size_t>(shift + 1) * SUB_BUCKETS + ((nanoseconds >> shift) - SUB_BUCKETS);
+	return std::min(bucket, BUCKET_COUNT - 1);
+}
+
+uint64_t Metrics::GetBucketUpperBound(std::size_t bucket) {
+	constexpr uint64_t SUB_BUCKETS = uint64_t{ 1 } << SUB_BUCKET_BITS;
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+	const int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+	const uint64_t subBucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+	return ((subBucket + 1) << shift) - 1;
+}
+
+Metrics::ThreadBlock& Metrics::GetThreadBlock() {
+	static thread_local BlockOwner<ThreadBlock> owner;
+	return owner.Get();
+}
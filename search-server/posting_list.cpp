@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "headers/posting_list.h"
+
+namespace {
+	void WriteVarint(uint32_t value, std::vector<uint8_t>& out) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	template <typename Value>
+	void AppendRaw(std::string& out, const Value* values, std::size_t count) {
+		out.append(reinterpret_cast<const char*>(values), count * sizeof(Value));
+	}
+
+	template <typename Value>
+	void ReadRaw(std::string_view& data, Value* values, std::size_t count) {
+		if (data.size() / sizeof(Value) < count) {
+			throw std::runtime_error("posting list is truncated");
+		}
+		// an empty vector may have no storage, which memcpy must not get
+		if (count > 0) {
+			std::memcpy(values, data.data(), count * sizeof(Value));
+		}
+		data.remove_prefix(count * sizeof(Value));
+	}
+}
+
+void PostingList::Append(int documentIndex, uint32_t count) {
+	Detach();
+	tail.push_back({ documentIndex, count });
+	++postingCount;
+	if (tail.size() == BLOCK_SIZE) {
+		SealTail();
+	}
+}
+
+bool PostingList::Contains(int documentIndex)const {
+	const std::size_t block = FindBlock(documentIndex);
+	if (block < blocks.size()) {
+		if (blocks[block].firstDocumentIndex > documentIndex) {
+			return false;
+		}
+		const uint8_t* position = GetBytes() + blocks[block].offset;
+		int current = blocks[block].firstDocumentIndex;
+		for (uint32_t i = 0; i < blocks[block].postingCount && current <= documentIndex; ++i) {
+			current += ReadVarint(position);
+			ReadVarint(position);
+			if (current == documentIndex) {
+				return true;
+			}
+		}
+		return false;
+	}
+	return std::binary_search(tail.begin(), tail.end(), Posting{ documentIndex, 0 }, [](const Posting& lhs, const Posting& rhs) {
+		return lhs.documentIndex < rhs.documentIndex;
+	});
+}
+
+std::size_t PostingList::size()const {
+	return postingCount;
+}
+
+bool PostingList::empty()const {
+	return postingCount == 0;
+}
+
+int PostingList::GetFirstDocumentIndex()const {
+	return blocks.empty() ? tail.front().documentIndex : blocks.front().firstDocumentIndex;
+}
+
+int PostingList::GetLastDocumentIndex()const {
+	return tail.empty() ? blocks.back().lastDocumentIndex : tail.back().documentIndex;
+}
+
+std::size_t PostingList::GetMemoryUsage()const {
+	return blocks.capacity() * sizeof(Block) + bytes.capacity() + tail.capacity() * sizeof(Posting);
+}
+
+std::string PostingList::Serialize()const {
+	std::string out;
+	const std::size_t byteCount = storage ? sharedSize : bytes.size();
+	const uint64_t header[3] = { blocks.size(), byteCount, tail.size() };
+	AppendRaw(out, header, 3);
+	AppendRaw(out, blocks.data(), blocks.size());
+	AppendRaw(out, tail.data(), tail.size());
+	AppendRaw(out, GetBytes(), byteCount);
+	return out;
+}
+
+PostingList PostingList::Deserialize(std::string_view data, std::shared_ptr<const void> storage) {
+	PostingList list;
+	uint64_t header[3];
+	ReadRaw(data, header, 3);
+	if (header[0] > data.size() / sizeof(Block) || header[2] > data.size() / sizeof(Posting) || header[1] > data.size()) {
+		throw std::runtime_error("posting list is truncated");
+	}
+	list.blocks.resize(header[0]);
+	ReadRaw(data, list.blocks.data(), list.blocks.size());
+	list.tail.resize(header[2]);
+	ReadRaw(data, list.tail.data(), list.tail.size());
+	if (header[1] > data.size()) {
+		throw std::runtime_error("posting list is truncated");
+	}
+	const std::size_t byteCount = static_cast<std::size_t>(header[1]);
+	if (storage) {
+		list.storage = std::move(storage);
+		list.sharedBytes = reinterpret_cast<const uint8_t*>(data.data());
+		list.sharedSize = byteCount;
+	}
+	else {
+		list.bytes.resize(byteCount);
+		ReadRaw(data, list.bytes.data(), list.bytes.size());
+	}
+
+	list.postingCount = list.tail.size();
+	for (const Block& block : list.blocks) {
+		if (block.offset > byteCount || block.byteSize > byteCount - block.offset || block.byteSize < 2 * block.postingCount) {
+			throw std::runtime_error("posting list block is out of bounds");
+		}
+		list.postingCount += block.postingCount;
+	}
+	return list;
+}
+
+PostingList::Cursor::Cursor(const PostingList& list) :list(&list) {
+	EnterBlock(0);
+	Next();
+}
+
+void PostingList::Cursor::Advance(int target) {
+	if (documentIndex >= target) {
+		return;
+	}
+	if (block < list->blocks.size() && list->blocks[block].lastDocumentIndex < target) {
+		const auto next = std::lower_bound(list->blocks.begin() + block + 1, list->blocks.end(), target, [](const Block& candidate, int index) {
+			return candidate.lastDocumentIndex < index;
+		});
+		EnterBlock(next - list->blocks.begin());
+		Next();
+	}
+	while (documentIndex < target) {
+		Next();
+	}
+}
+
+void PostingList::Cursor::EnterBlock(std::size_t next) {
+	block = next;
+	remaining = 0;
+	if (block < list->blocks.size()) {
+		// the first gap of a block is 0, so decoding starts from its first index
+		position = list->GetBytes() + list->blocks[block].offset;
+		documentIndex = list->blocks[block].firstDocumentIndex;
+		remaining = list->blocks[block].postingCount;
+	}
+}
+
+void PostingList::Detach() {
+	if (storage) {
+		bytes.assign(sharedBytes, sharedBytes + sharedSize);
+		storage.reset();
+		sharedBytes = nullptr;
+		sharedSize = 0;
+	}
+}
+
+void PostingList::SealTail() {
+	const uint64_t offset = bytes.size();
+	EncodeBlock(tail, bytes);
+	blocks.push_back({ tail.front().documentIndex, tail.back().documentIndex, static_cast<uint32_t>(tail.size()), static_cast<uint32_t>(bytes.size() - offset), offset });
+	tail.clear();
+}
+
+void PostingList::EncodeBlock(const std::vector<Posting>& postings, std::vector<uint8_t>& out) {
+	int previous = postings.empty() ? 0 : postings.front().documentIndex;
+	for (const Posting& posting : postings) {
+		WriteVarint(static_cast<uint32_t>(posting.documentIndex - previous), out);
+		WriteVarint(posting.count, out);
+		previous = posting.documentIndex;
+	}
+}
+
+std::size_t PostingList::FindBlock(int documentIndex)const {
+	return std::lower_bound(blocks.begin(), blocks.end(), documentIndex, [](const Block& block, int index) {
+		return block.lastDocumentIndex < index;
+	}) - blocks.begin();
+}
@@ -10,20 +10,20 @@
 #include "headers/document.h"
 
 
+QueryBatchResult ProcessQueriesBatch(const SearchServer& search_server, const std::vector<std::string>& queries) {
+	return search_server.FindTopDocumentsBatch(queries);
+}
+
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
-	std::vector<std::vector<Document>> result(queries.size());
-	std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(), [&search_server](const std::string& query) {
-		return search_server.FindTopDocuments(query);
-	});
+	const QueryBatchResult batch = ProcessQueriesBatch(search_server, queries);
+	std::vector<std::vector<Document>> result(batch.GetQueryCount());
+	for (std::size_t i = 0; i < result.size(); ++i) {
+		QueryBatchResult::Range documents = batch[i];
+		result[i].assign(documents.begin(), documents.end());
+	}
 	return result;
 }
 
 std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
-	std::vector<Document> result;
-	for (const std::vector<Document>& arDoc : ProcessQueries(search_server, queries)){
-		for (const Document& doc : arDoc){
-			result.push_back(doc);
-		}
-	}
-	return result;
+	return ProcessQueriesBatch(search_server, queries).ExtractDocuments();
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#include "headers/query_batch_result.h"
+
+QueryBatchResult::QueryBatchResult(std::vector<Document> documents, std::vector<std::size_t> offsets) :documents(std::move(documents)), offsets(std::move(offsets)) {}
+
+std::size_t QueryBatchResult::GetQueryCount()const {
+	return offsets.size() - 1;
+}
+
+QueryBatchResult::Range QueryBatchResult::operator[](std::size_t query)const {
+	return { documents.begin() + offsets[query], documents.begin() + offsets[query + 1] };
+}
+
+const std::vector<Document>& QueryBatchResult::GetDocuments()const {
+	return documents;
+}
+
+const std::vector<std::size_t>& QueryBatchResult::GetOffsets()const {
+	return offsets;
+}
+
+std::vector<Document> QueryBatchResult::ExtractDocuments() {
+	std::vector<Document> result = std::move(documents);
+	documents.clear();
+	offsets.assign(1, 0);
+	return result;
+}
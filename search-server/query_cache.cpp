@@ -0,0 +1,55 @@
+#include "headers/query_cache.h"
+
+QueryCache::QueryCache(std::size_t capacity) :capacity(capacity) {}
+
+bool QueryCache::Find(const std::string& key, uint64_t generation, std::vector<Document>& result) {
+	std::lock_guard guard(mutex);
+	auto it = entriesByKey.find(key);
+	if (it == entriesByKey.end()) {
+		++misses;
+		return false;
+	}
+	if (it->second->generation != generation) {
+		// computed before the last AddDocument or RemoveDocument
+		entries.erase(it->second);
+		entriesByKey.erase(it);
+		++misses;
+		return false;
+	}
+	entries.splice(entries.begin(), entries, it->second);
+	result = it->second->documents;
+	++hits;
+	return true;
+}
+
+void QueryCache::Insert(std::string key, uint64_t generation, std::vector<Document> documents) {
+	std::lock_guard guard(mutex);
+	if (capacity == 0) {
+		return;
+	}
+	auto it = entriesByKey.find(key);
+	if (it != entriesByKey.end()) {
+		it->second->generation = generation;
+		it->second->documents = std::move(documents);
+		entries.splice(entries.begin(), entries, it->second);
+		return;
+	}
+	if (entries.size() == capacity) {
+		entriesByKey.erase(entries.back().key);
+		entries.pop_back();
+		++evictions;
+	}
+	entries.push_front({ std::move(key), generation, std::move(documents) });
+	entriesByKey.emplace(entries.front().key, entries.begin());
+}
+
+void QueryCache::Clear() {
+	std::lock_guard guard(mutex);
+	entriesByKey.clear();
+	entries.clear();
+}
+
+QueryCache::Statistics QueryCache::GetStatistics()const {
+	std::lock_guard guard(mutex);
+	return { hits, misses, evictions, entries.size() };
+}
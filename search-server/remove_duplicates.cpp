@@ -1,33 +1,189 @@
-#include <map>
-#include <string>
-#include <set>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
 #include "headers/search_server.h"
 #include "headers/remove_duplicates.h"
 
-void RemoveDuplicates(SearchServer& searchServer){
-	std::map<std::set<std::string_view>, int> words;
-	std::vector<int> removeIds;
-	for(const int docId : searchServer){
-		std::set<std::string_view> key;
-		for(const auto& [word, tf]: searchServer.GetWordFrequencies(docId)){
-			key.insert(word);
-		}
-
-		int itemId = words[key];
-		if(itemId > 0){
-			if(itemId > docId){
-				removeIds.push_back(itemId);
-				words[key] = docId;
-			}else{
-				removeIds.push_back(docId);
+namespace {
+	// MinHash values per document used by RemoveNearDuplicates
+	const int MIN_HASH_COUNT = 64;
+
+	struct Fingerprint {
+		uint64_t low;
+		uint64_t high;
+
+		bool operator==(const Fingerprint& other)const {
+			return low == other.low && high == other.high;
+		}
+	};
+
+	struct FingerprintHasher {
+		std::size_t operator()(const Fingerprint& fingerprint)const {
+			return static_cast<std::size_t>(fingerprint.low);
+		}
+	};
+
+	// final mixing step of MurmurHash3, spreads every input bit over the output
+	uint64_t Mix(uint64_t value) {
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+
+	uint64_t HashWord(std::string_view word, uint64_t seed) {
+		uint64_t hash = seed ^ (word.size() * 0x9e3779b97f4a7c15ULL);
+		for (const char ch : word) {
+			hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+		}
+		return Mix(hash);
+	}
+
+	// words of a document sorted, the exact check behind every fingerprint match
+	std::vector<std::string_view> GetSortedWords(const IndexVersion& version, int documentId) {
+		std::vector<std::string_view> words;
+		for (const auto& [word, tf] : version.GetWordFrequencies(documentId)) {
+			words.push_back(word);
+		}
+		std::sort(words.begin(), words.end());
+		return words;
+	}
+
+	double GetJaccardSimilarity(const std::vector<std::string_view>& lhs, const std::vector<std::string_view>& rhs) {
+		std::size_t common = 0;
+		for (auto left = lhs.begin(), right = rhs.begin(); left != lhs.end() && right != rhs.end();) {
+			if (*left < *right) {
+				++left;
+			}
+			else if (*right < *left) {
+				++right;
+			}
+			else {
+				++common;
+				++left;
+				++right;
 			}
-		}else{
-			words[key] = docId;
 		}
+		const std::size_t united = lhs.size() + rhs.size() - common;
+		return united == 0 ? 1.0 : static_cast<double>(common) / united;
 	}
 
-	for(const int docId: removeIds){
-		searchServer.RemoveDocument(docId);
-		std::cout << "Found duplicate document id " << docId << "\n";
+	std::vector<int> RemoveDocuments(SearchServer& searchServer, std::vector<int> removeIds) {
+		std::sort(removeIds.begin(), removeIds.end());
+		for (const int documentId : removeIds) {
+			searchServer.RemoveDocument(documentId);
+		}
+		return removeIds;
+	}
+}
+
+std::vector<int> RemoveDuplicates(SearchServer& searchServer) {
+	// one version for the whole pass: merges and the removals below publish newer ones
+	const DocumentIdRange documents = searchServer.GetDocumentIds();
+	const IndexVersion& version = documents.GetVersion();
+	const std::vector<int>& documentIds = version.GetDocumentIds();
+
+	// a set is fingerprinted by summing the hashes of its words, which does not depend on their order
+	std::vector<Fingerprint> fingerprints(documentIds.size());
+	searchServer.GetThreadPool().ParallelFor(documentIds.size(), [&](std::size_t i) {
+		Fingerprint fingerprint{ 0, 0 };
+		for (const auto& [word, tf] : version.GetWordFrequencies(documentIds[i])) {
+			fingerprint.low += HashWord(word, 0);
+			fingerprint.high += HashWord(word, 0x5bd1e995);
+		}
+		fingerprints[i] = fingerprint;
+	});
+
+	// documents are visited by increasing id, so the first of every set of words is kept
+	std::unordered_map<Fingerprint, std::vector<std::size_t>, FingerprintHasher> keptByFingerprint;
+	std::vector<int> removeIds;
+	for (std::size_t i = 0; i < documentIds.size(); ++i) {
+		std::vector<std::size_t>& kept = keptByFingerprint[fingerprints[i]];
+		if (kept.empty()) {
+			kept.push_back(i);
+			continue;
+		}
+		const std::vector<std::string_view> words = GetSortedWords(version, documentIds[i]);
+		const bool duplicate = std::any_of(kept.begin(), kept.end(), [&](std::size_t original) {
+			return GetSortedWords(version, documentIds[original]) == words;
+		});
+		if (duplicate) {
+			removeIds.push_back(documentIds[i]);
+		}
+		else {
+			kept.push_back(i);
+		}
+	}
+	return RemoveDocuments(searchServer, std::move(removeIds));
+}
+
+std::vector<int> RemoveNearDuplicates(SearchServer& searchServer, double threshold) {
+	if (!(threshold > 0.0 && threshold <= 1.0)) {
+		throw std::invalid_argument("similarity threshold must be in (0, 1]");
+	}
+	// the banding whose S-curve midpoint (1/bands)^(1/rows) is the largest one not above the threshold
+	int rows = 1;
+	for (int candidate = 1; candidate <= MIN_HASH_COUNT; candidate *= 2) {
+		if (std::pow(static_cast<double>(candidate) / MIN_HASH_COUNT, 1.0 / candidate) <= threshold) {
+			rows = candidate;
+		}
+	}
+	const int bands = MIN_HASH_COUNT / rows;
+
+	// one version for the whole pass, it also keeps the words below alive
+	const DocumentIdRange documents = searchServer.GetDocumentIds();
+	const IndexVersion& version = documents.GetVersion();
+	const std::vector<int>& documentIds = version.GetDocumentIds();
+	std::vector<std::vector<std::string_view>> words(documentIds.size());
+	std::vector<uint64_t> bandHashes(documentIds.size() * bands);
+	searchServer.GetThreadPool().ParallelFor(documentIds.size(), [&](std::size_t i) {
+		words[i] = GetSortedWords(version, documentIds[i]);
+		std::vector<uint64_t> signature(MIN_HASH_COUNT, UINT64_MAX);
+		for (std::string_view word : words[i]) {
+			// every MinHash function is the word hash remixed with its own seed
+			const uint64_t hash = HashWord(word, 0);
+			for (int function = 0; function < MIN_HASH_COUNT; ++function) {
+				signature[function] = std::min(signature[function], Mix(hash ^ (function + 1) * 0x9e3779b97f4a7c15ULL));
+			}
+		}
+		for (int band = 0; band < bands; ++band) {
+			uint64_t bandHash = band;
+			for (int row = 0; row < rows; ++row) {
+				bandHash = Mix(bandHash ^ signature[band * rows + row]);
+			}
+			bandHashes[i * bands + band] = bandHash;
+		}
+	});
+
+	// kept documents of every band bucket; a document is compared with those sharing a bucket
+	std::vector<std::unordered_map<uint64_t, std::vector<std::size_t>>> buckets(bands);
+	std::vector<int> removeIds;
+	std::vector<std::size_t> candidates;
+	for (std::size_t i = 0; i < documentIds.size(); ++i) {
+		candidates.clear();
+		for (int band = 0; band < bands; ++band) {
+			auto bucket = buckets[band].find(bandHashes[i * bands + band]);
+			if (bucket != buckets[band].end()) {
+				candidates.insert(candidates.end(), bucket->second.begin(), bucket->second.end());
+			}
+		}
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		const bool duplicate = std::any_of(candidates.begin(), candidates.end(), [&](std::size_t original) {
+			return GetJaccardSimilarity(words[original], words[i]) >= threshold;
+		});
+		if (duplicate) {
+			removeIds.push_back(documentIds[i]);
+			continue;
+		}
+		for (int band = 0; band < bands; ++band) {
+			buckets[band][bandHashes[i * bands + band]].push_back(i);
+		}
 	}
+	return RemoveDocuments(searchServer, std::move(removeIds));
 }
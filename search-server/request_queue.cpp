@@ -1,40 +1,128 @@
+#include <algorithm>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
-#include <deque>
 #include "headers/search_server.h"
 #include "headers/request_queue.h"
 
+namespace {
+	// at most this many stripes, more threads share them
+	const std::size_t MAX_STRIPES = 16;
 
-RequestQueue::RequestQueue(const SearchServer& searchServer):search(searchServer){
-	no_results_requests_ = 0;
-	current_time_ = 0;
+	// threads are numbered once and keep their stripe in every queue
+	std::size_t GetThreadNumber() {
+		static std::atomic<std::size_t> nextNumber = 0;
+		static thread_local const std::size_t number = nextNumber.fetch_add(1, std::memory_order_relaxed);
+		return number;
+	}
+}
+
+double RequestQueue::Statistics::GetRequestsPerSecond()const {
+	return seconds > 0 ? requests / seconds : 0.0;
+}
+
+double RequestQueue::Statistics::GetNoResultRate()const {
+	return requests > 0 ? static_cast<double>(noResultRequests) / requests : 0.0;
+}
+
+RequestQueue::RequestQueue(const SearchServer& searchServer, Clock::duration window, Clock::duration resolution)
+	:search(searchServer), start(Clock::now()), resolution(resolution) {
+	if (resolution <= Clock::duration::zero() || window < resolution) {
+		throw std::invalid_argument("request window is invalid");
+	}
+	bucketCount = static_cast<std::size_t>((window + resolution - Clock::duration(1)) / resolution);
+	stripeCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, MAX_STRIPES);
+	buckets = std::make_unique<Bucket[]>(bucketCount * stripeCount);
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& rawQuery, DocumentStatus status) {
-	return AddFindRequest(rawQuery, [status](int document_id, DocumentStatus documentStatus, int rating){
-		return documentStatus == status;
-	});
+	const Clock::time_point requestStart = Clock::now();
+	std::vector<Document> result = search.FindTopDocuments(rawQuery, status);
+	Record(FIRST_STATUS + static_cast<std::size_t>(status), result.size(), Clock::now() - requestStart);
+	return result;
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& rawQuery) {
 	return AddFindRequest(rawQuery, DocumentStatus::ACTUAL);
 }
 
+std::vector<Document> RequestQueue::AddFindRequest(QueryContext& context, const std::string& rawQuery, DocumentStatus status) {
+	const Clock::time_point requestStart = Clock::now();
+	std::vector<Document> result = search.FindTopDocuments(context, rawQuery, status);
+	Record(FIRST_STATUS + static_cast<std::size_t>(status), result.size(), Clock::now() - requestStart);
+	return result;
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(QueryContext& context, const std::string& rawQuery) {
+	return AddFindRequest(context, rawQuery, DocumentStatus::ACTUAL);
+}
+
 int RequestQueue::GetNoResultRequests() const {
-	return no_results_requests_;
+	return static_cast<int>(GetStatistics().noResultRequests);
 }
 
-void RequestQueue::dequeAction(unsigned results_num){
-	++current_time_;
-	while (!requests_.empty() && min_in_day_ <= current_time_ - requests_.front().timestamp) {
-		if (0 == requests_.front().results) {
-			--no_results_requests_;
+RequestQueue::Statistics RequestQueue::GetStatistics()const {
+	const Clock::time_point now = Clock::now();
+	const uint64_t last = GetBucketNumber(now);
+	const uint64_t first = last + 1 > bucketCount ? last + 1 - bucketCount : 0;
+	std::array<uint64_t, COUNTER_COUNT> counts{};
+	for (uint64_t number = first; number <= last; ++number) {
+		const uint64_t tag = GetTag(number);
+		for (std::size_t stripe = 0; stripe < stripeCount; ++stripe) {
+			const Bucket& bucket = buckets[stripe * bucketCount + number % bucketCount];
+			for (std::size_t counter = 0; counter < COUNTER_COUNT; ++counter) {
+				counts[counter] += Read(bucket.counters[counter], tag);
+			}
 		}
-		requests_.pop_front();
 	}
-	requests_.push_back({current_time_, results_num});
-	if (0 == results_num) {
-		++no_results_requests_;
+
+	Statistics statistics;
+	statistics.noResultRequests = counts[NO_RESULTS];
+	for (std::size_t status = 0; status < IndexSegment::STATUS_COUNT; ++status) {
+		statistics.statusRequests[status] = counts[FIRST_STATUS + status];
+		statistics.requests += counts[FIRST_STATUS + status];
+	}
+	statistics.predicateRequests = counts[PREDICATE];
+	statistics.requests += counts[PREDICATE];
+	std::copy(counts.begin() + FIRST_LATENCY, counts.end(), statistics.latencyRequests.begin());
+	const Clock::duration covered = std::min<Clock::duration>(now - start, resolution * static_cast<Clock::rep>(bucketCount));
+	statistics.seconds = std::chrono::duration<double>(covered).count();
+	return statistics;
+}
+
+void RequestQueue::Record(std::size_t requestKind, std::size_t resultCount, Clock::duration latency) {
+	const uint64_t number = GetBucketNumber(Clock::now());
+	const uint64_t tag = GetTag(number);
+	Bucket& bucket = buckets[GetThreadNumber() % stripeCount * bucketCount + number % bucketCount];
+	Increment(bucket.counters[requestKind], tag);
+	if (resultCount == 0) {
+		Increment(bucket.counters[NO_RESULTS], tag);
 	}
-}
\ No newline at end of file
+	const std::size_t latencyClass = std::upper_bound(LATENCY_BOUNDS.begin(), LATENCY_BOUNDS.end(), latency) - LATENCY_BOUNDS.begin();
+	Increment(bucket.counters[FIRST_LATENCY + latencyClass], tag);
+}
+
+uint64_t RequestQueue::GetBucketNumber(Clock::time_point time)const {
+	return static_cast<uint64_t>((time - start) / resolution);
+}
+
+uint64_t RequestQueue::GetTag(uint64_t bucketNumber) {
+	// 0 is the tag of a counter never written; tags repeat after 2^32 buckets,
+	// far longer than a counter stays unwritten in a queue that is in use
+	return ((bucketNumber + 1) & ((uint64_t{ 1 } << (64 - COUNT_BITS)) - 1)) << COUNT_BITS;
+}
+
+void RequestQueue::Increment(std::atomic<uint64_t>& counter, uint64_t tag) {
+	constexpr uint64_t COUNT_MASK = (uint64_t{ 1 } << COUNT_BITS) - 1;
+	uint64_t value = counter.load(std::memory_order_relaxed);
+	while (!counter.compare_exchange_weak(value, (value & ~COUNT_MASK) == tag ? value + 1 : tag | 1, std::memory_order_relaxed)) {
+	}
+}
+
+uint64_t RequestQueue::Read(const std::atomic<uint64_t>& counter, uint64_t tag) {
+	constexpr uint64_t COUNT_MASK = (uint64_t{ 1 } << COUNT_BITS) - 1;
+	const uint64_t value = counter.load(std::memory_order_relaxed);
+	return (value & ~COUNT_MASK) == tag ? value & COUNT_MASK : 0;
+}
@@ -0,0 +1,40 @@
+#include <algorithm>
+#include "headers/score_accumulator.h"
+
+ScoreAccumulator& ScoreAccumulator::ForCurrentThread() {
+	static thread_local ScoreAccumulator accumulator;
+	return accumulator;
+}
+
+void ScoreAccumulator::Reset(std::size_t documentCount) {
+	if (scores.size() < documentCount) {
+		scores.resize(documentCount);
+		stamps.resize(documentCount, 0);
+	}
+	touched.clear();
+	++generation;
+	if (generation == 0) {
+		// the stamp counter wrapped around, old stamps could look current again
+		std::fill(stamps.begin(), stamps.end(), 0);
+		generation = 1;
+	}
+}
+
+void ScoreAccumulator::Add(int documentIndex, double score) {
+	if (stamps[documentIndex] != generation) {
+		stamps[documentIndex] = generation;
+		scores[documentIndex] = score;
+		touched.push_back(documentIndex);
+	}
+	else {
+		scores[documentIndex] += score;
+	}
+}
+
+void ScoreAccumulator::Erase(int documentIndex) {
+	stamps[documentIndex] = 0;
+}
+
+std::size_t ScoreAccumulator::GetTouchedCount()const {
+	return touched.size();
+}
@@ -0,0 +1,9 @@
+#include "headers/search_page.h"
+
+bool SearchCursor::IsEnd()const {
+	return end;
+}
+
+uint64_t SearchCursor::GetGeneration()const {
+	return generation;
+}
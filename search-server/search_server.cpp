@@ -1,7 +1,13 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <unordered_set>
 #include <stdexcept>
 #include <execution>
 #include "headers/string_processing.h"
 #include "headers/search_server.h"
+#include "headers/snapshot.h"
+
 
 SearchServer::SearchServer() {}
 
@@ -9,24 +15,159 @@ SearchServer::SearchServer(const std::string& stopWordsContainer) :SearchServer(
 SearchServer::SearchServer(std::string_view stopWordsContainer) :SearchServer(SplitIntoWords(stopWordsContainer)) {}
 
 void SearchServer::AddDocument(int documentId, std::string_view document, DocumentStatus status, const std::vector<int>& docRating) {
-	CheckDocumentId(documentId);
+	StageTimer timer(Metrics::Stage::INDEXING);
+	const std::unique_lock<std::mutex> lock = index->LockWrites();
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	CheckDocumentId(*current, documentId);
+	CheckStatus(status);
 	const std::vector<std::string_view> words = SplitIntoWordsNoStop(document, stopWords);
-	documentsIds.insert(documentId);
-	int size = words.size();
-	double tf = 1.0 / size;
-
+	std::map<std::string_view, uint32_t> termCounts;
 	for (std::string_view word : words) {
-		documents[static_cast<std::string>(word)][documentId] += tf;
-		wordFreq[documentId][static_cast<std::string>(word)] += tf;
+		++termCounts[word];
+	}
+	timer.Mark(Metrics::Stage::TOKENIZE);
+	auto segment = std::make_shared<IndexSegment>();
+	const int documentIndex = segment->AddDocument(documentId, ComputeAverageRating(docRating), status, static_cast<uint32_t>(words.size()));
+	TermStatistics::Changes changes;
+	for (const auto& [word, count] : termCounts) {
+		segment->AddPosting(word, documentIndex, count);
+		changes.push_back({ word, 1 });
+	}
+	segment->Seal();
+	std::shared_ptr<const TermStatistics> termStatistics = current->GetTermStatistics()->Update(changes);
+
+	// a merge or a removal since the last call replaced the pending segment, the document
+	// then starts a new one
+	std::vector<std::shared_ptr<const IndexSegment>> segments = current->GetSegments();
+	if (!segments.empty() && segments.back() == pendingSegment && static_cast<std::size_t>(pendingSegment->GetSize()) < MAX_PENDING_DOCUMENTS) {
+		segments.back() = IndexSegment::Merge({ pendingSegment, std::move(segment) });
+	}
+	else {
+		segments.push_back(std::move(segment));
+	}
+	pendingSegment = segments.back();
+	timer.Mark(Metrics::Stage::BUILD_SEGMENT);
+	index->Publish(std::move(segments), std::move(termStatistics));
+	timer.Mark(Metrics::Stage::PUBLISH);
+	Metrics::Increment(Metrics::Counter::DOCUMENTS_ADDED);
+}
+
+IndexingStatistics SearchServer::AddDocuments(const std::vector<DocumentInput>& batch) {
+	const auto startTime = std::chrono::steady_clock::now();
+	StageTimer timer(Metrics::Stage::INDEXING);
+	PreparedDocuments prepared = PrepareDocuments(batch, timer);
+	CommitDocuments(prepared, timer);
+
+	IndexingStatistics statistics;
+	statistics.documents = prepared.documents;
+	statistics.bytes = prepared.bytes;
+	statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	return statistics;
+}
+
+PreparedDocuments SearchServer::PrepareDocuments(const std::vector<DocumentInput>& batch)const {
+	StageTimer timer;
+	return PrepareDocuments(batch, timer);
+}
+
+void SearchServer::CommitDocuments(const PreparedDocuments& prepared) {
+	StageTimer timer;
+	CommitDocuments(prepared, timer);
+}
+
+PreparedDocuments SearchServer::PrepareDocuments(const std::vector<DocumentInput>& batch, StageTimer& timer)const {
+	// ids are checked against the index here to fail early and again by CommitDocuments,
+	// as other writers may add the same ids in between
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	std::unordered_set<int> batchIds;
+	for (const DocumentInput& document : batch) {
+		CheckDocumentId(*current, document.id);
+		CheckStatus(document.status);
+		if (!batchIds.insert(document.id).second) {
+			throw std::invalid_argument("document id alredy exist");
+		}
+	}
+
+	// contiguous chunks keep the postings of every chunk sorted by document index,
+	// so merging the chunks in order is a plain append
+	const std::size_t chunkCount = std::max<std::size_t>(1, std::min(batch.size() / MIN_DOCUMENTS_PER_CHUNK, (threadPool->GetThreadCount() + 1) * 4));
+	const std::size_t chunkSize = batch.size() / chunkCount + 1;
+	std::vector<std::unordered_map<std::string_view, std::vector<Posting>>> chunkPostings(chunkCount);
+	std::vector<uint32_t> batchLengths(batch.size());
+	threadPool->ParallelFor(chunkCount, [&](std::size_t chunk) {
+		const std::size_t end = std::min(batch.size(), (chunk + 1) * chunkSize);
+		std::map<std::string_view, uint32_t> termCounts;
+		for (std::size_t i = chunk * chunkSize; i < end; ++i) {
+			const std::vector<std::string_view> words = SplitIntoWordsNoStop(batch[i].text, stopWords);
+			batchLengths[i] = static_cast<uint32_t>(words.size());
+			termCounts.clear();
+			for (std::string_view word : words) {
+				++termCounts[word];
+			}
+			for (const auto& [word, count] : termCounts) {
+				chunkPostings[chunk][word].push_back({ static_cast<int>(i), count });
+			}
+		}
+	});
+	timer.Mark(Metrics::Stage::TOKENIZE);
+
+	// the whole batch becomes one segment, published only once it is complete
+	auto segment = std::make_shared<IndexSegment>();
+	PreparedDocuments prepared;
+	prepared.documents = batch.size();
+	for (std::size_t i = 0; i < batch.size(); ++i) {
+		const DocumentInput& document = batch[i];
+		segment->AddDocument(document.id, ComputeAverageRating(document.ratings), document.status, batchLengths[i]);
+		prepared.bytes += document.text.size();
 	}
+	for (auto& postings : chunkPostings) {
+		for (auto& [word, list] : postings) {
+			segment->AddPostings(word, list);
+		}
+	}
+	segment->Seal();
+	prepared.segment = std::move(segment);
+	timer.Mark(Metrics::Stage::BUILD_SEGMENT);
+	return prepared;
+}
+
+void SearchServer::CommitDocuments(const PreparedDocuments& prepared, StageTimer& timer) {
+	if (prepared.documents == 0) {
+		return;
+	}
+	const IndexSegment& segment = *prepared.segment;
+	const std::unique_lock<std::mutex> lock = index->LockWrites();
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	for (int documentIndex = 0; documentIndex < segment.GetSize(); ++documentIndex) {
+		CheckDocumentId(*current, segment.GetDocumentId(documentIndex));
+	}
+	TermStatistics::Changes changes;
+	for (std::size_t termId = 0; termId < segment.GetTermCount(); ++termId) {
+		changes.push_back({ segment.GetTerm(static_cast<int>(termId)), static_cast<int>(segment.GetPostings(static_cast<int>(termId)).size()) });
+	}
+	std::shared_ptr<const TermStatistics> termStatistics = current->GetTermStatistics()->Update(changes);
+	timer.Mark(Metrics::Stage::BUILD_SEGMENT);
+	std::vector<std::shared_ptr<const IndexSegment>> segments = current->GetSegments();
+	segments.push_back(prepared.segment);
+	index->Publish(std::move(segments), std::move(termStatistics));
+	timer.Mark(Metrics::Stage::PUBLISH);
+	Metrics::Increment(Metrics::Counter::DOCUMENTS_ADDED, prepared.documents);
+}
 
-	documentsRatingStatus[documentId].rating = ComputeAverageRating(docRating);
-	documentsRatingStatus[documentId].status = status;
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view rawQuery, DocumentStatus status, std::size_t topCount)const {
+	QueryContext context;
+	return FindTopDocuments(context, rawQuery, status, topCount);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view rawQuery, DocumentStatus status)const {
-	return FindTopDocuments(rawQuery, [status](int documentId, DocumentStatus documentStatus, int rating) {
-		return documentStatus == status;
+std::vector<Document> SearchServer::FindTopDocuments(QueryContext& context, std::string_view rawQuery, DocumentStatus status, std::size_t topCount)const {
+	StageTimer timer(Metrics::Stage::QUERY);
+	Metrics::Increment(Metrics::Counter::QUERIES);
+	ParseQuery(rawQuery, context.tokens, context.query);
+	RemoveDuplicateWords(context.query);
+	timer.Mark(Metrics::Stage::PARSE);
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	return FindTopDocumentsCached(*current, context.query, status, topCount, context.key, [&] {
+		return FindAllDocuments(*current, context, StatusFilter{ status }, TopDocuments(topCount), timer);
 	});
 }
 
@@ -34,48 +175,187 @@ std::vector<Document> SearchServer::FindTopDocuments(std::string_view rawQuery)c
 	return FindTopDocuments(rawQuery, DocumentStatus::ACTUAL);
 }
 
+SearchPage SearchServer::FindTopDocumentsPage(std::string_view rawQuery, DocumentStatus status, const SearchCursor& cursor, std::size_t pageSize)const {
+	return FindTopDocumentsPage(rawQuery, StatusFilter{ status }, cursor, pageSize);
+}
+
+SearchPage SearchServer::FindTopDocumentsPage(std::string_view rawQuery, const SearchCursor& cursor)const {
+	return FindTopDocumentsPage(rawQuery, DocumentStatus::ACTUAL, cursor);
+}
+
+QueryBatchResult SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& rawQueries, DocumentStatus status, std::size_t topCount)const {
+	// parsing and term lookup are shared by the batch and timed for it as a whole,
+	// the scoring stages of each distinct query are timed by the worker running it
+	StageTimer timer;
+	Metrics::Increment(Metrics::Counter::BATCH_QUERIES, rawQueries.size());
+	std::vector<ParsedQuery> queries(rawQueries.size());
+	threadPool->ParallelFor(rawQueries.size(), [&](std::size_t i) {
+		queries[i] = ParseQuery(rawQueries[i]);
+		RemoveDuplicateWords(queries[i]);
+	});
+	timer.Mark(Metrics::Stage::PARSE);
+
+	std::vector<std::size_t> uniqueQueryOf(queries.size());
+	std::vector<std::size_t> uniqueQueries;
+	std::unordered_map<std::string, std::size_t> uniqueByKey;
+	for (std::size_t i = 0; i < queries.size(); ++i) {
+		const auto [it, inserted] = uniqueByKey.emplace(GetQueryKey(queries[i]), uniqueQueries.size());
+		if (inserted) {
+			uniqueQueries.push_back(i);
+		}
+		uniqueQueryOf[i] = it->second;
+	}
+
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	const auto& segments = current->GetSegments();
+	const std::shared_ptr<QueryCache> cache = GetQueryCache();
+	std::vector<std::vector<Document>> uniqueResults(uniqueQueries.size());
+	std::vector<std::string> cacheKeys(cache ? uniqueQueries.size() : 0);
+	std::vector<char> cached(uniqueQueries.size(), false);
+	for (std::size_t unique = 0; unique < cacheKeys.size(); ++unique) {
+		GetCacheKey(queries[uniqueQueries[unique]], status, topCount, cacheKeys[unique]);
+		cached[unique] = cache->Find(cacheKeys[unique], current->GetGeneration(), uniqueResults[unique]);
+	}
+
+	// every distinct word gets its idf and its posting list in each segment once
+	struct ResolvedWord {
+		double idf;
+		std::vector<const PostingList*> postings;
+		std::vector<double> maxTermFrequencies;
+	};
+	std::unordered_map<std::string_view, ResolvedWord> terms;
+	for (std::size_t unique = 0; unique < uniqueQueries.size(); ++unique) {
+		if (cached[unique]) {
+			continue;
+		}
+		const std::size_t queryIndex = uniqueQueries[unique];
+		for (const std::vector<std::string_view>* words : { &queries[queryIndex].plusWords, &queries[queryIndex].minusWords }) {
+			for (std::string_view word : *words) {
+				if (terms.count(word) > 0) {
+					continue;
+				}
+				ResolvedWord& resolved = terms[word];
+				resolved.idf = current->GetIdf(word);
+				for (const auto& segment : segments) {
+					const int termId = segment->FindTerm(word);
+					const bool found = termId != IndexSegment::NOT_FOUND && !segment->GetPostings(termId).empty();
+					resolved.postings.push_back(found ? &segment->GetPostings(termId) : nullptr);
+					resolved.maxTermFrequencies.push_back(found ? segment->GetMaxTermFrequency(termId) : 0.0);
+				}
+			}
+		}
+	}
+	timer.Mark(Metrics::Stage::TERM_LOOKUP);
+
+	const StatusFilter filter{ status };
+	threadPool->ParallelFor(uniqueQueries.size(), [&](std::size_t unique) {
+		if (cached[unique]) {
+			return;
+		}
+		StageTimer queryTimer;
+		const ParsedQuery& query = queries[uniqueQueries[unique]];
+		std::vector<QueryTerm> plusTerms;
+		std::vector<const PostingList*> minusPostings;
+		TopDocuments matched_documents(topCount);
+		for (std::size_t i = 0; i < segments.size(); ++i) {
+			plusTerms.clear();
+			for (std::string_view word : query.plusWords) {
+				const ResolvedWord& resolved = terms.at(word);
+				if (resolved.postings[i] != nullptr) {
+					plusTerms.push_back({ resolved.postings[i], resolved.idf, resolved.maxTermFrequencies[i] });
+				}
+			}
+			if (plusTerms.empty()) {
+				continue;
+			}
+			minusPostings.clear();
+			for (std::string_view word : query.minusWords) {
+				const ResolvedWord& resolved = terms.at(word);
+				if (resolved.postings[i] != nullptr) {
+					minusPostings.push_back(resolved.postings[i]);
+				}
+			}
+			ScoreDocuments(*segments[i], plusTerms, minusPostings, filter, matched_documents, queryTimer);
+		}
+		uniqueResults[unique] = matched_documents.Extract();
+		queryTimer.Mark(Metrics::Stage::TOP_K);
+		if (cache) {
+			cache->Insert(cacheKeys[unique], current->GetGeneration(), uniqueResults[unique]);
+		}
+	});
+
+	std::vector<std::size_t> offsets(queries.size() + 1, 0);
+	for (std::size_t i = 0; i < queries.size(); ++i) {
+		offsets[i + 1] = offsets[i] + uniqueResults[uniqueQueryOf[i]].size();
+	}
+	std::vector<Document> joined(offsets.back());
+	threadPool->ParallelFor(queries.size(), [&](std::size_t i) {
+		const std::vector<Document>& result = uniqueResults[uniqueQueryOf[i]];
+		std::copy(result.begin(), result.end(), joined.begin() + offsets[i]);
+	});
+	return { std::move(joined), std::move(offsets) };
+}
+
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view rawQuery, int documentId) {
 	return MatchDocument(rawQuery, documentId);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy&, std::string_view rawQuery, int documentId) {
-	Query queryWords = ParseQuery(rawQuery);
-	DocumentStatus status = documentsRatingStatus.at(documentId).status;
-	std::vector<std::string_view> findWords(queryWords.plusWords.size());
-	bool exit = false;
-	std::for_each(std::execution::par, queryWords.minusWords.begin(), queryWords.minusWords.end(), [&](std::string_view word) {
-		if (!exit && documents.count(static_cast<std::string>(word)) && documents.at(static_cast<std::string>(word)).count(documentId)) {
+	ParsedQuery queryWords = ParseQuery(rawQuery);
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	int documentIndex = 0;
+	const IndexSegment& segment = FindDocumentSegment(*current, documentId, documentIndex);
+	const DocumentStatus status = segment.GetStatus(documentIndex);
+	std::atomic<bool> exit = false;
+	threadPool->ParallelFor(queryWords.minusWords.size(), [&](std::size_t i) {
+		if (!exit && ContainsDocument(segment, queryWords.minusWords[i], documentIndex)) {
 			exit = true;
 		}
-		});
+	});
 
 	if (exit) {
-		return { {}, status };
+		return { std::vector<std::string_view>{}, status };
 	}
-	auto resCopy = std::copy_if(std::execution::par, queryWords.plusWords.begin(), queryWords.plusWords.end(), findWords.begin(), [&](std::string_view word) {
-		return (documents.count(static_cast<std::string>(word)) && documents.at(static_cast<std::string>(word)).count(documentId));
-		});
-	std::sort(std::execution::par, findWords.begin(), resCopy);
-	auto lastPlus = std::unique(findWords.begin(), resCopy);
+	std::vector<char> found(queryWords.plusWords.size());
+	threadPool->ParallelFor(queryWords.plusWords.size(), [&](std::size_t i) {
+		found[i] = ContainsDocument(segment, queryWords.plusWords[i], documentIndex);
+	});
+	std::vector<std::string_view> findWords;
+	for (std::size_t i = 0; i < found.size(); ++i) {
+		if (found[i]) {
+			findWords.push_back(queryWords.plusWords[i]);
+		}
+	}
+	std::sort(findWords.begin(), findWords.end());
+	auto lastPlus = std::unique(findWords.begin(), findWords.end());
 	findWords.erase(lastPlus, findWords.end());
 	return { findWords, status };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view rawQuery, int documentId)const {
-	Query queryWords = ParseQuery(rawQuery);
+	QueryContext context;
+	return MatchDocument(context, rawQuery, documentId);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(QueryContext& context, std::string_view rawQuery, int documentId)const {
+	ParseQuery(rawQuery, context.tokens, context.query);
+	ParsedQuery& queryWords = context.query;
 	std::sort(queryWords.plusWords.begin(), queryWords.plusWords.end());
 	auto lastPlus = std::unique(queryWords.plusWords.begin(), queryWords.plusWords.end());
 	queryWords.plusWords.erase(lastPlus, queryWords.plusWords.end());
 	std::vector<std::string_view> findWords;
-	DocumentStatus status = documentsRatingStatus.at(documentId).status;
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	int documentIndex = 0;
+	const IndexSegment& segment = FindDocumentSegment(*current, documentId, documentIndex);
+	const DocumentStatus status = segment.GetStatus(documentIndex);
 	for (std::string_view word : queryWords.minusWords) {
-		if (documents.count(static_cast<std::string>(word)) && documents.at(static_cast<std::string>(word)).count(documentId)) {
-			return { {}, status };
+		if (ContainsDocument(segment, word, documentIndex)) {
+			return { std::vector<std::string_view>{}, status };
 		}
 	}
 
 	for (std::string_view word : queryWords.plusWords) {
-		if (documents.count(static_cast<std::string>(word)) && documents.at(static_cast<std::string>(word)).count(documentId)) {
+		if (ContainsDocument(segment, word, documentIndex)) {
 			findWords.push_back(word);
 		}
 	}
@@ -83,44 +363,246 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 }
 
 unsigned SearchServer::GetDocumentCount()const {
-	return documentsIds.size();
+	return GetVersion()->GetDocumentCount();
 }
 
-std::set<int>::const_iterator SearchServer::begin()const {
-	return documentsIds.begin();
+DocumentIdRange SearchServer::GetDocumentIds()const {
+	return DocumentIdRange(GetVersion());
 }
 
-std::set<int>::const_iterator SearchServer::end()const {
-	return documentsIds.end();
+DocumentIdRange::Iterator SearchServer::begin()const {
+	return GetDocumentIds().begin();
 }
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int documentId)const {
-	static std::map<std::string_view, double> wordFreqRes;
-	if (documentsIds.count(documentId) == 0) {
-		return wordFreqRes;
-	}
 
-	wordFreqRes.insert(wordFreq.at(documentId).begin(), wordFreq.at(documentId).end());
-	return wordFreqRes;
+DocumentIdRange::Iterator SearchServer::end()const {
+	return {};
+}
 
+WordFrequencies SearchServer::GetWordFrequencies(int documentId)const {
+	return GetVersion()->GetWordFrequencies(documentId);
 }
+
 void SearchServer::RemoveDocument(int documentId) {
-	if (documentsIds.count(documentId) > 0) {
-		for (const auto& [word, tf] : wordFreq.at(documentId)) {
-			if (documents.at(word).count(documentId) > 0) {
-				documents.at(word).erase(documentId);
-			}
+	const std::unique_lock<std::mutex> lock = index->LockWrites();
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	int documentIndex = 0;
+	const IndexSegment* removing = current->FindDocument(documentId, documentIndex);
+	if (removing == nullptr) {
+		return;
+	}
+	TermStatistics::Changes changes;
+	for (const auto& [word, tf] : removing->GetWordFrequencies(documentIndex)) {
+		changes.push_back({ word, -1 });
+	}
+	std::vector<std::shared_ptr<const IndexSegment>> segments = current->GetSegments();
+	for (auto& segment : segments) {
+		if (segment.get() == removing) {
+			segment = segment->RemoveDocument(documentIndex);
 		}
-		documentsIds.erase(documentId);
 	}
+	index->Publish(std::move(segments), current->GetTermStatistics()->Update(changes));
+	Metrics::Increment(Metrics::Counter::DOCUMENTS_REMOVED);
+}
+
+SegmentedIndex::Statistics SearchServer::Compact() {
+	return index->Compact();
+}
+
+std::shared_ptr<const IndexVersion> SearchServer::GetVersion()const {
+	return index->GetVersion();
 }
-bool SearchServer::CheckWord(const std::string& word)const {
-	for (const char ch : word) {
-		int code = int(ch);
-		if (code >= 0 && code < 32) {
-			return false;
+
+void SearchServer::SetThreadPool(std::shared_ptr<ThreadPool> pool) {
+	threadPool = std::move(pool);
+}
+
+ThreadPool& SearchServer::GetThreadPool()const {
+	return *threadPool;
+}
+
+void SearchServer::Save(const std::string& path)const {
+	SnapshotWriter writer(path);
+
+	writer.BeginSection(SnapshotSection::STOP_WORDS);
+	writer.WriteStrings(std::vector<std::string_view>(stopWords.begin(), stopWords.end()));
+	writer.EndSection();
+
+	// a snapshot holds one segment without the removed documents
+	const std::shared_ptr<const IndexVersion> current = GetVersion();
+	const std::shared_ptr<const IndexSegment> documents = IndexSegment::Merge(current->GetSegments());
+	const std::size_t termCount = documents->GetTermCount();
+	std::vector<std::string_view> terms(termCount);
+	for (std::size_t termId = 0; termId < termCount; ++termId) {
+		terms[termId] = documents->GetTerm(static_cast<int>(termId));
+	}
+	writer.BeginSection(SnapshotSection::TERMS);
+	writer.WriteStrings(terms);
+	writer.EndSection();
+
+	// posting lists are stored in their compressed form, each padded to 8 bytes
+	std::vector<std::string> serializedPostings(termCount);
+	threadPool->ParallelFor(termCount, [&](std::size_t termId) {
+		serializedPostings[termId] = documents->GetPostings(static_cast<int>(termId)).Serialize();
+		serializedPostings[termId].resize((serializedPostings[termId].size() + 7) / 8 * 8);
+	});
+	writer.BeginSection(SnapshotSection::POSTING_OFFSETS);
+	uint64_t postingOffset = 0;
+	writer.Write(&postingOffset, sizeof(postingOffset));
+	for (const std::string& serialized : serializedPostings) {
+		postingOffset += serialized.size();
+		writer.Write(&postingOffset, sizeof(postingOffset));
+	}
+	writer.EndSection();
+
+	writer.BeginSection(SnapshotSection::POSTINGS);
+	for (const std::string& serialized : serializedPostings) {
+		writer.Write(serialized.data(), serialized.size());
+	}
+	writer.EndSection();
+
+	writer.BeginSection(SnapshotSection::DOCUMENTS);
+	for (int documentIndex = 0; documentIndex < documents->GetSize(); ++documentIndex) {
+		const SnapshotDocument record{ documents->GetDocumentId(documentIndex), documents->GetRating(documentIndex), static_cast<int32_t>(documents->GetStatus(documentIndex)), !documents->IsRemoved(documentIndex), documents->GetLength(documentIndex) };
+		writer.Write(&record, sizeof(record));
+	}
+	writer.EndSection();
+
+	// the forward index and the term statistics are stored too, so Load decodes no posting
+	const IndexSegment::ForwardIndex forwardIndex = documents->GetForwardIndex();
+	const std::pair<SnapshotSection, std::string_view> forwardSections[] = {
+		{ SnapshotSection::FORWARD_OFFSETS, forwardIndex.offsets },
+		{ SnapshotSection::FORWARD_ENTRIES, forwardIndex.entries },
+		{ SnapshotSection::MAX_TERM_FREQUENCIES, forwardIndex.maxTermFrequencies }
+	};
+	for (const auto& [section, data] : forwardSections) {
+		writer.BeginSection(section);
+		writer.Write(data.data(), data.size());
+		writer.EndSection();
+	}
+
+	writer.BeginSection(SnapshotSection::DOCUMENT_FREQUENCIES);
+	for (std::string_view term : terms) {
+		const uint32_t documentFrequency = static_cast<uint32_t>(documents->GetDocumentFrequency(term));
+		writer.Write(&documentFrequency, sizeof(documentFrequency));
+	}
+	writer.EndSection();
+
+	writer.Finish();
+}
+
+SearchServer SearchServer::Load(const std::string& path) {
+	// the posting lists read their blocks from the mapping and keep it open
+	const auto reader = std::make_shared<const SnapshotReader>(path);
+	SearchServer server(SnapshotReader::ReadStrings(reader->GetSection(SnapshotSection::STOP_WORDS)));
+
+	const std::string_view documentSection = reader->GetSection(SnapshotSection::DOCUMENTS);
+	if (documentSection.size() % sizeof(SnapshotDocument) != 0) {
+		throw std::runtime_error("snapshot document table is corrupted");
+	}
+	const std::size_t documentCount = documentSection.size() / sizeof(SnapshotDocument);
+	auto segment = std::make_shared<IndexSegment>();
+	// marked once the segment is sealed, which counts their postings as removed
+	std::vector<int> removedIndexes;
+	for (std::size_t documentIndex = 0; documentIndex < documentCount; ++documentIndex) {
+		SnapshotDocument record;
+		std::memcpy(&record, documentSection.data() + documentIndex * sizeof(record), sizeof(record));
+		if (record.status < static_cast<int32_t>(DocumentStatus::ACTUAL) || record.status > static_cast<int32_t>(DocumentStatus::REMOVED)) {
+			throw std::runtime_error("snapshot document status is corrupted");
+		}
+		segment->AddDocument(record.id, record.rating, static_cast<DocumentStatus>(record.status), record.length);
+		if (record.alive == 0) {
+			removedIndexes.push_back(static_cast<int>(documentIndex));
 		}
 	}
-	return true;
+
+	const std::vector<std::string_view> terms = SnapshotReader::ReadStrings(reader->GetSection(SnapshotSection::TERMS));
+	const std::string_view offsetSection = reader->GetSection(SnapshotSection::POSTING_OFFSETS);
+	const std::string_view postingSection = reader->GetSection(SnapshotSection::POSTINGS);
+	if (offsetSection.size() != (terms.size() + 1) * sizeof(uint64_t)) {
+		throw std::runtime_error("snapshot posting offsets are corrupted");
+	}
+	uint64_t postingBegin = 0;
+	for (std::size_t termId = 0; termId < terms.size(); ++termId) {
+		uint64_t postingEnd = 0;
+		std::memcpy(&postingEnd, offsetSection.data() + (termId + 1) * sizeof(uint64_t), sizeof(postingEnd));
+		if (postingEnd < postingBegin || postingEnd > postingSection.size()) {
+			throw std::runtime_error("snapshot posting offsets are corrupted");
+		}
+		PostingList list = PostingList::Deserialize(postingSection.substr(postingBegin, postingEnd - postingBegin), reader);
+		postingBegin = postingEnd;
+		// the checksum vouches for the contents of the blocks, their skip entries suffice here
+		if (list.empty() || list.GetFirstDocumentIndex() < 0 || static_cast<std::size_t>(list.GetLastDocumentIndex()) >= documentCount) {
+			throw std::runtime_error("snapshot posting refers to a missing document");
+		}
+		segment->AddPostings(terms[termId], std::move(list));
+	}
+	segment->Seal({ reader->GetSection(SnapshotSection::FORWARD_OFFSETS), reader->GetSection(SnapshotSection::FORWARD_ENTRIES), reader->GetSection(SnapshotSection::MAX_TERM_FREQUENCIES) }, reader);
+	for (int documentIndex : removedIndexes) {
+		segment->MarkRemoved(documentIndex);
+	}
+
+	const std::string_view frequencySection = reader->GetSection(SnapshotSection::DOCUMENT_FREQUENCIES);
+	if (frequencySection.size() != terms.size() * sizeof(uint32_t)) {
+		throw std::runtime_error("snapshot document frequencies are corrupted");
+	}
+	if (documentCount > 0) {
+		const std::unique_lock<std::mutex> lock = server.index->LockWrites();
+		std::shared_ptr<const TermStatistics> termStatistics = TermStatistics::Build(terms, reinterpret_cast<const uint32_t*>(frequencySection.data()), reader);
+		server.index->Publish({ std::move(segment) }, std::move(termStatistics));
+	}
+	return server;
+}
+
+void SearchServer::EnableQueryCache(std::size_t capacity) {
+	std::atomic_store(&queryCache, std::make_shared<QueryCache>(capacity));
+}
+
+void SearchServer::DisableQueryCache() {
+	std::atomic_store(&queryCache, std::shared_ptr<QueryCache>());
+}
+
+std::shared_ptr<QueryCache> SearchServer::GetQueryCache()const {
+	return std::atomic_load(&queryCache);
+}
+
+IndexSegment::Statistics SearchServer::GetIndexStatistics()const {
+	return GetVersion()->GetStatistics();
+}
+
+void SearchServer::SetMergePolicy(const MergePolicy& policy) {
+	index->SetMergePolicy(policy);
+}
+
+MergePolicy SearchServer::GetMergePolicy()const {
+	return index->GetMergePolicy();
+}
+
+void SearchServer::MergeSegments() {
+	index->Merge();
+}
+
+SegmentedIndex::Statistics SearchServer::GetMergeStatistics()const {
+	return index->GetStatistics();
+}
+
+void SearchServer::SetScoringMode(ScoringMode mode) {
+	scoringMode = mode;
+}
+
+ScoringMode SearchServer::GetScoringMode()const {
+	return scoringMode;
+}
+
+QueryCache::Statistics SearchServer::GetQueryCacheStatistics()const {
+	const std::shared_ptr<QueryCache> cache = GetQueryCache();
+	if (!cache) {
+		return { 0, 0, 0, 0 };
+	}
+	return cache->GetStatistics();
+}
+
+bool SearchServer::CheckWord(std::string_view word) {
+	return FindControlCharacter(word) == word.npos;
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -130,8 +612,9 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
 	return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
-void SearchServer::CheckDocumentId(int documentId)const {
-	if (documentsRatingStatus.count(documentId)) {
+void SearchServer::CheckDocumentId(const IndexVersion& current, int documentId)const {
+	int documentIndex = 0;
+	if (current.FindDocument(documentId, documentIndex) != nullptr) {
 		throw std::invalid_argument("document id alredy exist");
 	}
 
@@ -140,28 +623,48 @@ void SearchServer::CheckDocumentId(int documentId)const {
 	}
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, const std::set<std::string>& stopWords)const {
+void SearchServer::CheckStatus(DocumentStatus status) {
+	// segments keep a bitset per status
+	if (static_cast<std::size_t>(status) >= IndexSegment::STATUS_COUNT) {
+		throw std::invalid_argument("document status is invalid");
+	}
+}
+
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text, const std::set<std::string, std::less<>>& stopWords)const {
 	std::vector<std::string_view> words;
-	for (std::string_view word : SplitIntoWords(text)) {
-		if (!CheckWord(static_cast<std::string>(word))) {
-			std::string wordPrint(word);
-			throw std::invalid_argument("the word " + wordPrint + " contains wrong symbol");
-		}
-		if (stopWords.count(static_cast<std::string>(word)) == 0) {
-			words.push_back(word);
-		}
+	const std::size_t controlPosition = Tokenize(text, words);
+	if (controlPosition != text.npos) {
+		// report the whole word holding the character
+		const std::size_t wordBegin = text.rfind(' ', controlPosition);
+		const std::size_t begin = wordBegin == text.npos ? 0 : wordBegin + 1;
+		std::string wordPrint(text.substr(begin, text.find(' ', controlPosition) - begin));
+		throw std::invalid_argument("the word " + wordPrint + " contains wrong symbol");
 	}
+	words.erase(std::remove_if(words.begin(), words.end(), [&stopWords](std::string_view word) {
+		return stopWords.count(word) > 0;
+	}), words.end());
 	return words;
 }
 
-bool SearchServer::IsStopWord(const std::string& word)const {
+bool SearchServer::IsStopWord(std::string_view word)const {
 	return stopWords.count(word);
 }
 
-SearchServer::Query SearchServer::ParseQuery(std::string_view text)const {
-	Query query;
-	for (std::string_view word : SplitIntoWords(text)) {
-		const QueryWord queryWord = ParseQueryWord(word);
+ParsedQuery SearchServer::ParseQuery(std::string_view text)const {
+	std::vector<std::string_view> tokens;
+	ParsedQuery query;
+	ParseQuery(text, tokens, query);
+	return query;
+}
+
+void SearchServer::ParseQuery(std::string_view text, std::vector<std::string_view>& tokens, ParsedQuery& query)const {
+	tokens.clear();
+	query.plusWords.clear();
+	query.minusWords.clear();
+	const std::size_t controlPosition = Tokenize(text, tokens);
+	for (std::string_view word : tokens) {
+		const std::size_t wordBegin = word.data() - text.data();
+		const QueryWord queryWord = ParseQueryWord(word, controlPosition >= wordBegin && controlPosition < wordBegin + word.size());
 		if (!queryWord.isStop) {
 			if (queryWord.isMinus) {
 				query.minusWords.push_back(queryWord.data);
@@ -171,16 +674,15 @@ SearchServer::Query SearchServer::ParseQuery(std::string_view text)const {
 			}
 		}
 	}
-	return query;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word)const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word, bool hasControlCharacter)const {
 	unsigned size = word.size();
 	if (word[0] == '-' && (size == 1 || word[1] == '-' || word[1] == ' ')) {
 		throw std::invalid_argument("query word contains extra -");
 	}
 
-	if (!CheckWord(static_cast<std::string>(word))) {
+	if (hasControlCharacter) {
 		throw std::invalid_argument("query word contains a wrong character");
 	}
 
@@ -193,6 +695,54 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string_view word)const
 	return {
 		word,
 		isMinus,
-		IsStopWord(static_cast<std::string>(word))
+		IsStopWord(word)
 	};
-}
\ No newline at end of file
+}
+
+const IndexSegment& SearchServer::FindDocumentSegment(const IndexVersion& current, int documentId, int& documentIndex) {
+	const IndexSegment* segment = current.FindDocument(documentId, documentIndex);
+	if (segment == nullptr) {
+		throw std::out_of_range("document id not found");
+	}
+	return *segment;
+}
+
+bool SearchServer::ContainsDocument(const IndexSegment& segment, std::string_view word, int documentIndex) {
+	const PostingList* postings = segment.FindPostings(word);
+	return postings != nullptr && postings->Contains(documentIndex);
+}
+
+std::string SearchServer::GetQueryKey(const ParsedQuery& query) {
+	std::string key;
+	AppendQueryKey(query, key);
+	return key;
+}
+
+void SearchServer::AppendQueryKey(const ParsedQuery& query, std::string& key) {
+	// control characters are rejected while parsing, so they cannot clash with query words
+	for (std::string_view word : query.plusWords) {
+		key.append(word).push_back('\x1f');
+	}
+	key.push_back('\x1e');
+	for (std::string_view word : query.minusWords) {
+		key.append(word).push_back('\x1f');
+	}
+}
+
+void SearchServer::GetCacheKey(const ParsedQuery& query, DocumentStatus status, std::size_t topCount, std::string& key) {
+	key.clear();
+	AppendQueryKey(query, key);
+	key.append(std::to_string(static_cast<int>(status))).push_back('\x1d');
+	key.append(std::to_string(topCount));
+}
+
+void SearchServer::RemoveDuplicateWords(ParsedQuery& query) {
+	std::sort(query.plusWords.begin(), query.plusWords.end());
+	std::sort(query.minusWords.begin(), query.minusWords.end());
+
+	auto lastMinus = std::unique(query.minusWords.begin(), query.minusWords.end());
+	query.minusWords.erase(lastMinus, query.minusWords.end());
+
+	auto lastPlus = std::unique(query.plusWords.begin(), query.plusWords.end());
+	query.plusWords.erase(lastPlus, query.plusWords.end());
+}
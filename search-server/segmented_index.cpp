@@ -0,0 +1,190 @@
+#include <algorithm>
+#include "headers/segmented_index.h"
+
+SegmentedIndex::SegmentedIndex(MergePolicy policy) :policy(policy) {}
+
+SegmentedIndex::~SegmentedIndex() {
+	{
+		std::lock_guard<std::mutex> lock(writeMutex);
+		stopping = true;
+	}
+	mergeWanted.notify_one();
+	if (mergeThread.joinable()) {
+		mergeThread.join();
+	}
+}
+
+std::shared_ptr<const IndexVersion> SegmentedIndex::GetVersion()const {
+	return std::atomic_load(&version);
+}
+
+std::unique_lock<std::mutex> SegmentedIndex::LockWrites() {
+	return std::unique_lock<std::mutex>(writeMutex);
+}
+
+void SegmentedIndex::Publish(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics) {
+	if (!policy.backgroundMerging) {
+		MergeAll(segments);
+	}
+	while (segments.size() > std::max<std::size_t>(2, policy.maxSegments)) {
+		MergeSegments(segments, policy.FindForcedMerge(segments));
+	}
+	if (policy.backgroundMerging && !policy.FindMerge(segments).empty()) {
+		mergePending = true;
+		if (!mergeThread.joinable()) {
+			mergeThread = std::thread([this] {
+				RunMerges();
+			});
+		}
+		mergeWanted.notify_one();
+	}
+	PublishVersion(std::move(segments), std::move(termStatistics), true);
+}
+
+void SegmentedIndex::SetMergePolicy(const MergePolicy& policy) {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	this->policy = policy;
+}
+
+MergePolicy SegmentedIndex::GetMergePolicy()const {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	return policy;
+}
+
+void SegmentedIndex::Merge() {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::vector<std::shared_ptr<const IndexSegment>> segments = GetVersion()->GetSegments();
+	if (MergeAll(segments)) {
+		PublishVersion(std::move(segments), GetVersion()->GetTermStatistics(), false);
+	}
+}
+
+SegmentedIndex::Statistics SegmentedIndex::Compact() {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	const Statistics before = statistics;
+	std::vector<std::shared_ptr<const IndexSegment>> segments = GetVersion()->GetSegments();
+	// backwards, a segment left empty is erased
+	for (std::size_t i = segments.size(); i-- > 0;) {
+		if (segments[i]->GetRemovedCount() > 0) {
+			MergeSegments(segments, { i });
+		}
+	}
+	if (statistics.merges > before.merges) {
+		std::shared_ptr<const TermStatistics> termStatistics = TermStatistics::Build(segments);
+		PublishVersion(std::move(segments), std::move(termStatistics), false);
+	}
+	return {
+		statistics.merges - before.merges,
+		statistics.mergedDocuments - before.mergedDocuments,
+		statistics.droppedDocuments - before.droppedDocuments,
+		statistics.reclaimedBytes - before.reclaimedBytes
+	};
+}
+
+SegmentedIndex::Statistics SegmentedIndex::GetStatistics()const {
+	std::lock_guard<std::mutex> lock(writeMutex);
+	return statistics;
+}
+
+void SegmentedIndex::PublishVersion(std::vector<std::shared_ptr<const IndexSegment>> segments, std::shared_ptr<const TermStatistics> termStatistics, bool documentsChanged) {
+	const uint64_t generation = GetVersion()->GetGeneration() + (documentsChanged ? 1 : 0);
+	std::atomic_store(&version, std::shared_ptr<const IndexVersion>(std::make_shared<IndexVersion>(std::move(segments), std::move(termStatistics), generation)));
+}
+
+bool SegmentedIndex::MergeAll(std::vector<std::shared_ptr<const IndexSegment>>& segments) {
+	bool merged = false;
+	for (std::vector<std::size_t> positions = policy.FindMerge(segments); !positions.empty(); positions = policy.FindMerge(segments)) {
+		MergeSegments(segments, positions);
+		merged = true;
+	}
+	return merged;
+}
+
+void SegmentedIndex::MergeSegments(std::vector<std::shared_ptr<const IndexSegment>>& segments, const std::vector<std::size_t>& positions) {
+	std::vector<std::shared_ptr<const IndexSegment>> merging;
+	for (std::size_t position : positions) {
+		merging.push_back(segments[position]);
+	}
+	ReplaceSegments(segments, positions, IndexSegment::Merge(merging));
+}
+
+void SegmentedIndex::ReplaceSegments(std::vector<std::shared_ptr<const IndexSegment>>& segments, const std::vector<std::size_t>& positions, std::shared_ptr<const IndexSegment> merged) {
+	std::size_t size = 0;
+	std::size_t bytes = 0;
+	for (std::size_t position : positions) {
+		size += segments[position]->GetSize();
+		bytes += segments[position]->GetMemoryUsage();
+	}
+	++statistics.merges;
+	statistics.mergedDocuments += merged->GetSize();
+	statistics.droppedDocuments += size - merged->GetSize();
+	statistics.reclaimedBytes += bytes - std::min(bytes, merged->GetMemoryUsage());
+	// scoring does not depend on the order of segments, so the others are simply erased
+	for (auto position = positions.rbegin(); position + 1 < positions.rend(); ++position) {
+		segments.erase(segments.begin() + *position);
+	}
+	if (merged->GetSize() > 0) {
+		segments[positions.front()] = std::move(merged);
+	}
+	else {
+		segments.erase(segments.begin() + positions.front());
+	}
+}
+
+void SegmentedIndex::RunMerges() {
+	std::unique_lock<std::mutex> lock(writeMutex);
+	while (!stopping) {
+		mergeWanted.wait(lock, [this] {
+			return mergePending || stopping;
+		});
+		mergePending = false;
+		lock.unlock();
+		while (!stopping && MergeInBackground()) {
+		}
+		lock.lock();
+	}
+}
+
+bool SegmentedIndex::MergeInBackground() {
+	std::vector<std::shared_ptr<const IndexSegment>> merging;
+	{
+		std::lock_guard<std::mutex> lock(writeMutex);
+		const std::shared_ptr<const IndexVersion> current = GetVersion();
+		for (std::size_t position : policy.FindMerge(current->GetSegments())) {
+			merging.push_back(current->GetSegments()[position]);
+		}
+		if (merging.empty()) {
+			return false;
+		}
+	}
+	// the expensive part runs unlocked, writers keep publishing meanwhile
+	std::shared_ptr<IndexSegment> merged = IndexSegment::Merge(merging);
+
+	std::lock_guard<std::mutex> lock(writeMutex);
+	std::vector<std::shared_ptr<const IndexSegment>> segments = GetVersion()->GetSegments();
+	// writers append segments and replace them on removals; a synchronous merge may have
+	// taken some of the merged ones, the policy is then asked again
+	std::vector<std::size_t> positions;
+	for (const auto& segment : merging) {
+		const auto found = std::find_if(segments.begin(), segments.end(), [&](const std::shared_ptr<const IndexSegment>& current) {
+			return current->IsVersionOf(*segment);
+		});
+		if (found == segments.end()) {
+			return true;
+		}
+		positions.push_back(found - segments.begin());
+	}
+	// documents removed during the merge are removed from its result as well
+	for (std::size_t i = 0; i < merging.size(); ++i) {
+		const IndexSegment& segment = *segments[positions[i]];
+		for (int documentIndex = 0; &segment != merging[i].get() && documentIndex < segment.GetSize(); ++documentIndex) {
+			if (segment.IsRemoved(documentIndex) && !merging[i]->IsRemoved(documentIndex)) {
+				merged = merged->RemoveDocument(merged->FindDocument(segment.GetDocumentId(documentIndex)));
+			}
+		}
+	}
+	std::sort(positions.begin(), positions.end());
+	ReplaceSegments(segments, positions, std::move(merged));
+	PublishVersion(std::move(segments), GetVersion()->GetTermStatistics(), false);
+	return true;
+}
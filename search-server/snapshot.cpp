@@ -0,0 +1,247 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <stdexcept>
+#include "headers/snapshot.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+namespace {
+	const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+	const uint64_t FNV_PRIME = 1099511628211ull;
+	const char PADDING[8] = {};
+
+	// a word at a time instead of a byte, so that checking a mapped snapshot costs a fraction
+	// of reading it; size is a multiple of 8
+	uint64_t UpdateChecksum(uint64_t checksum, const char* data, std::size_t size) {
+		for (std::size_t i = 0; i < size; i += sizeof(uint64_t)) {
+			uint64_t word;
+			std::memcpy(&word, data + i, sizeof(word));
+			checksum ^= word;
+			checksum *= FNV_PRIME;
+		}
+		return checksum;
+	}
+
+	// unique among the processes and threads saving at the same time, and in the
+	// directory of path so that the rename stays on one file system
+	std::string MakeTemporaryPath(const std::string& path) {
+		static std::atomic<uint64_t> saves = 0;
+#ifndef _WIN32
+		const long process = static_cast<long>(getpid());
+#else
+		const long process = static_cast<long>(_getpid());
+#endif
+		return path + "." + std::to_string(process) + "." + std::to_string(saves++) + ".tmp";
+	}
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+	:path(path), temporaryPath(MakeTemporaryPath(path)), out(temporaryPath, std::ios::binary | std::ios::trunc), header{}, position(sizeof(SnapshotHeader)), checksum(FNV_OFFSET_BASIS) {
+	if (!out) {
+		throw std::runtime_error("cannot create snapshot " + temporaryPath);
+	}
+	// the header is rewritten by Finish once the checksum is known
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void SnapshotWriter::BeginSection(SnapshotSection section) {
+	currentSection = section;
+	header.sections[static_cast<std::size_t>(section)].offset = position;
+}
+
+void SnapshotWriter::Write(const void* data, std::size_t size) {
+	const char* bytes = static_cast<const char*>(data);
+	out.write(bytes, size);
+	position += size;
+	if (partialSize > 0) {
+		const std::size_t copied = std::min(size, sizeof(partialWord) - partialSize);
+		std::memcpy(partialWord + partialSize, bytes, copied);
+		partialSize += copied;
+		bytes += copied;
+		size -= copied;
+		if (partialSize < sizeof(partialWord)) {
+			return;
+		}
+		checksum = UpdateChecksum(checksum, partialWord, sizeof(partialWord));
+		partialSize = 0;
+	}
+	const std::size_t whole = size - size % sizeof(partialWord);
+	checksum = UpdateChecksum(checksum, bytes, whole);
+	partialSize = size - whole;
+	std::memcpy(partialWord, bytes + whole, partialSize);
+}
+
+void SnapshotWriter::WriteStrings(const std::vector<std::string_view>& strings) {
+	const uint64_t count = strings.size();
+	Write(&count, sizeof(count));
+	uint64_t offset = 0;
+	Write(&offset, sizeof(offset));
+	for (std::string_view string : strings) {
+		offset += string.size();
+		Write(&offset, sizeof(offset));
+	}
+	for (std::string_view string : strings) {
+		Write(string.data(), string.size());
+	}
+}
+
+void SnapshotWriter::EndSection() {
+	SnapshotSectionEntry& entry = header.sections[static_cast<std::size_t>(currentSection)];
+	entry.size = position - entry.offset;
+	Write(PADDING, (8 - position % 8) % 8);
+	currentSection = SnapshotSection::COUNT;
+}
+
+void SnapshotWriter::Finish() {
+	std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.byteOrderMark = SNAPSHOT_BYTE_ORDER_MARK;
+	header.fileSize = position;
+	header.checksum = checksum;
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.close();
+	if (!out) {
+		throw std::runtime_error("cannot write snapshot " + temporaryPath);
+	}
+#ifndef _WIN32
+	// the data reaches the disk before the rename makes it the snapshot
+	const int fd = open(temporaryPath.c_str(), O_RDONLY);
+	const bool synced = fd >= 0 && fsync(fd) == 0;
+	if (fd >= 0) {
+		close(fd);
+	}
+	if (!synced) {
+		throw std::runtime_error("cannot sync snapshot " + temporaryPath);
+	}
+#endif
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		throw std::runtime_error("cannot replace snapshot " + path + ": " + error.message());
+	}
+	finished = true;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	if (!finished) {
+		out.close();
+		std::error_code error;
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) {
+#ifndef _WIN32
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("cannot open snapshot " + path);
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		throw std::runtime_error("cannot read snapshot " + path);
+	}
+	size = static_cast<std::size_t>(fileStat.st_size);
+	if (size > 0) {
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			throw std::runtime_error("cannot map snapshot " + path);
+		}
+		data = static_cast<const char*>(mapping);
+	}
+	close(fd);
+#else
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if (!in) {
+		throw std::runtime_error("cannot open snapshot " + path);
+	}
+	buffer.resize(static_cast<std::size_t>(in.tellg()));
+	in.seekg(0);
+	in.read(buffer.data(), buffer.size());
+	data = buffer.data();
+	size = buffer.size();
+#endif
+	try {
+		if (size < sizeof(SnapshotHeader)) {
+			throw std::runtime_error("snapshot is truncated");
+		}
+		std::memcpy(&header, data, sizeof(header));
+		if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+			throw std::runtime_error("file is not a search server snapshot");
+		}
+		if (header.version != SNAPSHOT_VERSION || header.byteOrderMark != SNAPSHOT_BYTE_ORDER_MARK) {
+			throw std::runtime_error("unsupported snapshot version or byte order");
+		}
+		// sections are padded to whole words
+		if (header.fileSize != size || size % sizeof(uint64_t) != 0) {
+			throw std::runtime_error("snapshot is truncated");
+		}
+		if (UpdateChecksum(FNV_OFFSET_BASIS, data + sizeof(header), size - sizeof(header)) != header.checksum) {
+			throw std::runtime_error("snapshot checksum mismatch");
+		}
+		for (const SnapshotSectionEntry& entry : header.sections) {
+			if (entry.offset > size || entry.size > size - entry.offset) {
+				throw std::runtime_error("snapshot section is out of bounds");
+			}
+		}
+	}
+	catch (...) {
+#ifndef _WIN32
+		if (data != nullptr) {
+			munmap(const_cast<char*>(data), size);
+		}
+#endif
+		throw;
+	}
+}
+
+SnapshotReader::~SnapshotReader() {
+#ifndef _WIN32
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+	}
+#endif
+}
+
+std::string_view SnapshotReader::GetSection(SnapshotSection section)const {
+	const SnapshotSectionEntry& entry = header.sections[static_cast<std::size_t>(section)];
+	return { data + entry.offset, static_cast<std::size_t>(entry.size) };
+}
+
+std::vector<std::string_view> SnapshotReader::ReadStrings(std::string_view section) {
+	uint64_t count = 0;
+	if (section.size() < sizeof(count)) {
+		throw std::runtime_error("snapshot string table is truncated");
+	}
+	std::memcpy(&count, section.data(), sizeof(count));
+	const std::size_t blobStart = sizeof(uint64_t) * (count + 2);
+	if (count > section.size() / sizeof(uint64_t) || blobStart > section.size()) {
+		throw std::runtime_error("snapshot string table is truncated");
+	}
+	const char* offsets = section.data() + sizeof(uint64_t);
+	std::vector<std::string_view> strings;
+	strings.reserve(count);
+	uint64_t begin = 0;
+	for (uint64_t i = 1; i <= count; ++i) {
+		uint64_t end = 0;
+		std::memcpy(&end, offsets + i * sizeof(uint64_t), sizeof(end));
+		if (end < begin || end > section.size() - blobStart) {
+			throw std::runtime_error("snapshot string table is corrupted");
+		}
+		strings.push_back(section.substr(blobStart + begin, end - begin));
+		begin = end;
+	}
+	return strings;
+}
@@ -1,13 +1,198 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include "headers/string_processing.h"
 
+#if defined(__x86_64__) || defined(_M_X64)
+#define TOKENIZER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TOKENIZER_TARGET_AVX2
+#else
+#define TOKENIZER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+	const std::size_t BLOCK_SIZE = 64;
+
+	// one bit per byte of a BLOCK_SIZE block, lowest bit first
+	struct ByteMasks {
+		uint64_t spaces;
+		uint64_t controls;
+	};
+	using ClassifyBlock = ByteMasks(*)(const char* block);
+
+	int CountTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	ByteMasks ClassifyScalar(const char* block) {
+		ByteMasks masks{ 0, 0 };
+		for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+			const unsigned char ch = static_cast<unsigned char>(block[i]);
+			masks.spaces |= static_cast<uint64_t>(ch == ' ') << i;
+			masks.controls |= static_cast<uint64_t>(ch < 32) << i;
+		}
+		return masks;
+	}
+
+#ifdef TOKENIZER_X86
+	ByteMasks ClassifySse2(const char* block) {
+		const __m128i space = _mm_set1_epi8(' ');
+		const __m128i lastControl = _mm_set1_epi8(31);
+		ByteMasks masks{ 0, 0 };
+		for (std::size_t part = 0; part < BLOCK_SIZE / 16; ++part) {
+			const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + part * 16));
+			// SSE2 has no unsigned compare, bytes below 32 are those max(byte, 31) leaves at 31
+			const __m128i controls = _mm_cmpeq_epi8(_mm_max_epu8(bytes, lastControl), lastControl);
+			masks.spaces |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space)))) << (part * 16);
+			masks.controls |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(controls))) << (part * 16);
+		}
+		return masks;
+	}
+
+	TOKENIZER_TARGET_AVX2 ByteMasks ClassifyAvx2(const char* block) {
+		const __m256i space = _mm256_set1_epi8(' ');
+		const __m256i lastControl = _mm256_set1_epi8(31);
+		const __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+		const __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+		const uint32_t lowSpaces = _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, space));
+		const uint32_t highSpaces = _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, space));
+		const uint32_t lowControls = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(low, lastControl), lastControl));
+		const uint32_t highControls = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(high, lastControl), lastControl));
+		return { lowSpaces | static_cast<uint64_t>(highSpaces) << 32, lowControls | static_cast<uint64_t>(highControls) << 32 };
+	}
+
+	bool CpuSupportsAvx2() {
+#ifdef _MSC_VER
+		int registers[4];
+		__cpuid(registers, 1);
+		// the OS has to save the ymm registers as well
+		const bool avx = (registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+		__cpuidex(registers, 7, 0);
+		return avx && (registers[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	ClassifyBlock GetClassifier(TokenizerImplementation implementation) {
+		switch (implementation) {
+#ifdef TOKENIZER_X86
+		case TokenizerImplementation::AVX2:
+			return ClassifyAvx2;
+		case TokenizerImplementation::SSE2:
+			return ClassifySse2;
+#endif
+		default:
+			return ClassifyScalar;
+		}
+	}
+
+	// calls callback(position, masks) for every block, the last one padded with spaces
+	template <typename Callback>
+	void ForEachBlock(ClassifyBlock classify, std::string_view text, Callback callback) {
+		std::size_t position = 0;
+		for (; position + BLOCK_SIZE <= text.size(); position += BLOCK_SIZE) {
+			callback(position, classify(text.data() + position));
+		}
+		if (position < text.size()) {
+			char padded[BLOCK_SIZE];
+			std::memset(padded, ' ', BLOCK_SIZE);
+			std::memcpy(padded, text.data() + position, text.size() - position);
+			callback(position, classify(padded));
+		}
+	}
+}
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text){
 	std::vector<std::string_view> words;
-	int64_t pos = text.find_first_not_of(" ");
-	const int64_t pos_end = text.npos;
-	while (pos != pos_end) {
-		int64_t space = text.find(' ', pos);
-		words.push_back(space == pos_end ? text.substr(pos) : text.substr(pos, space - pos));
-		pos = text.find_first_not_of(" ", space);
-	}
+	Tokenize(text, words);
 	return words;
-}
\ No newline at end of file
+}
+
+std::size_t Tokenize(std::string_view text, std::vector<std::string_view>& words) {
+	return Tokenize(text, words, GetTokenizerImplementation());
+}
+
+std::size_t Tokenize(std::string_view text, std::vector<std::string_view>& words, TokenizerImplementation implementation) {
+	std::size_t controlPosition = text.npos;
+	std::size_t wordBegin = 0;
+	bool inWord = false;
+	ForEachBlock(GetClassifier(implementation), text, [&](std::size_t position, const ByteMasks& masks) {
+		if (controlPosition == text.npos && masks.controls != 0) {
+			controlPosition = position + CountTrailingZeros(masks.controls);
+		}
+		// a bit is set wherever a byte differs from its predecessor in being part of a word,
+		// so set bits alternate between word starts and the spaces ending them
+		const uint64_t wordBytes = ~masks.spaces;
+		for (uint64_t edges = wordBytes ^ (wordBytes << 1 | static_cast<uint64_t>(inWord)); edges != 0; edges &= edges - 1) {
+			const std::size_t edge = position + CountTrailingZeros(edges);
+			if (inWord) {
+				words.push_back(text.substr(wordBegin, edge - wordBegin));
+			}
+			else {
+				wordBegin = edge;
+			}
+			inWord = !inWord;
+		}
+	});
+	// only a text filling its last block exactly can end inside a word
+	if (inWord) {
+		words.push_back(text.substr(wordBegin));
+	}
+	return controlPosition;
+}
+
+std::size_t FindControlCharacter(std::string_view text) {
+	std::size_t controlPosition = text.npos;
+	ForEachBlock(GetClassifier(GetTokenizerImplementation()), text, [&](std::size_t position, const ByteMasks& masks) {
+		if (controlPosition == text.npos && masks.controls != 0) {
+			controlPosition = position + CountTrailingZeros(masks.controls);
+		}
+	});
+	return controlPosition;
+}
+
+TokenizerImplementation GetTokenizerImplementation() {
+	static const TokenizerImplementation implementation = IsTokenizerSupported(TokenizerImplementation::AVX2) ? TokenizerImplementation::AVX2
+		: IsTokenizerSupported(TokenizerImplementation::SSE2) ? TokenizerImplementation::SSE2
+		: TokenizerImplementation::SCALAR;
+	return implementation;
+}
+
+bool IsTokenizerSupported(TokenizerImplementation implementation) {
+	switch (implementation) {
+#ifdef TOKENIZER_X86
+	case TokenizerImplementation::AVX2:
+		return CpuSupportsAvx2();
+	case TokenizerImplementation::SSE2:
+		// part of the x86-64 baseline
+		return true;
+#endif
+	case TokenizerImplementation::SCALAR:
+		return true;
+	default:
+		return false;
+	}
+}
+
+const char* GetTokenizerName(TokenizerImplementation implementation) {
+	switch (implementation) {
+	case TokenizerImplementation::AVX2:
+		return "avx2";
+	case TokenizerImplementation::SSE2:
+		return "sse2";
+	default:
+		return "scalar";
+	}
+}
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include "headers/term_dictionary.h"
+
+int TermDictionary::Intern(std::string_view term) {
+	auto it = termIds.find(term);
+	if (it != termIds.end()) {
+		return it->second;
+	}
+	const int termId = static_cast<int>(terms.size());
+	std::string_view stored = Store(term);
+	terms.push_back(stored);
+	termIds.emplace(stored, termId);
+	return termId;
+}
+
+int TermDictionary::Find(std::string_view term)const {
+	auto it = termIds.find(term);
+	if (it == termIds.end()) {
+		return NOT_FOUND;
+	}
+	return it->second;
+}
+
+std::string_view TermDictionary::GetTerm(int termId)const {
+	return terms[termId];
+}
+
+std::size_t TermDictionary::Size()const {
+	return terms.size();
+}
+
+std::size_t TermDictionary::GetMemoryUsage()const {
+	std::size_t bytes = terms.capacity() * sizeof(std::string_view) + termIds.bucket_count() * sizeof(void*);
+	// every hash node holds its entry and the link to the next node
+	bytes += termIds.size() * (sizeof(std::pair<const std::string_view, int>) + sizeof(void*));
+	return bytes + arenaBytes;
+}
+
+std::string_view TermDictionary::Store(std::string_view term) {
+	if (term.size() > ARENA_BLOCK_SIZE) {
+		// an oversized term gets its own block, placed before the block that is being filled
+		auto block = arena.insert(arena.empty() ? arena.end() : std::prev(arena.end()), std::make_unique<char[]>(term.size()));
+		arenaBytes += term.size();
+		std::memcpy(block->get(), term.data(), term.size());
+		return { block->get(), term.size() };
+	}
+	if (arenaBlockUsed + term.size() > arenaBlockSize) {
+		arenaBlockSize = std::max(term.size(), std::min(ARENA_BLOCK_SIZE, std::max(FIRST_ARENA_BLOCK_SIZE, arenaBlockSize * 2)));
+		arena.push_back(std::make_unique<char[]>(arenaBlockSize));
+		arenaBlockUsed = 0;
+		arenaBytes += arenaBlockSize;
+	}
+	char* destination = arena.back().get() + arenaBlockUsed;
+	std::memcpy(destination, term.data(), term.size());
+	arenaBlockUsed += term.size();
+	return { destination, term.size() };
+}
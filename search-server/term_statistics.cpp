@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <tuple>
+#include "headers/term_statistics.h"
+
+namespace {
+	bool IsBefore(const TermStatistics::Entry& entry, std::string_view term) {
+		return entry.term < term;
+	}
+}
+
+TermStatistics::TermStatistics() :terms(std::make_shared<TermDictionary>()), shards(SHARD_COUNT, std::make_shared<const Shard>()), termsMemoryUsage(terms->GetMemoryUsage()) {}
+
+std::shared_ptr<const TermStatistics> TermStatistics::Build(const std::vector<std::shared_ptr<const IndexSegment>>& segments) {
+	Changes changes;
+	for (const auto& segment : segments) {
+		for (std::size_t termId = 0; termId < segment->GetTermCount(); ++termId) {
+			const std::string_view term = segment->GetTerm(static_cast<int>(termId));
+			changes.push_back({ term, static_cast<int>(segment->GetDocumentFrequency(term)) });
+		}
+	}
+	return TermStatistics().Update(changes);
+}
+
+std::shared_ptr<const TermStatistics> TermStatistics::Build(const std::vector<std::string_view>& terms, const uint32_t* documentFrequencies, std::shared_ptr<const void> storage) {
+	std::vector<Shard> shards(SHARD_COUNT);
+	auto statistics = std::make_shared<TermStatistics>();
+	for (std::size_t termId = 0; termId < terms.size(); ++termId) {
+		if (documentFrequencies[termId] > 0) {
+			shards[GetShard(terms[termId])].push_back({ terms[termId], documentFrequencies[termId], std::log(static_cast<double>(documentFrequencies[termId])) });
+			++statistics->termCount;
+		}
+	}
+	for (std::size_t shardIndex = 0; shardIndex < SHARD_COUNT; ++shardIndex) {
+		std::sort(shards[shardIndex].begin(), shards[shardIndex].end(), [](const Entry& lhs, const Entry& rhs) {
+			return lhs.term < rhs.term;
+		});
+		statistics->shards[shardIndex] = std::make_shared<const Shard>(std::move(shards[shardIndex]));
+	}
+	statistics->storage = std::move(storage);
+	statistics->storedTermCount = terms.size();
+	return statistics;
+}
+
+std::shared_ptr<const TermStatistics> TermStatistics::Update(const Changes& changes)const {
+	auto updated = std::make_shared<TermStatistics>(*this);
+	std::vector<std::pair<std::size_t, std::pair<std::string_view, int>>> sorted;
+	sorted.reserve(changes.size());
+	for (const auto& change : changes) {
+		sorted.push_back({ GetShard(change.first), change });
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+		return std::tie(lhs.first, lhs.second.first) < std::tie(rhs.first, rhs.second.first);
+	});
+
+	// every touched shard is rebuilt by merging its sorted entries with its sorted changes
+	for (std::size_t begin = 0, end = 0; begin < sorted.size(); begin = end) {
+		const std::size_t shardIndex = sorted[begin].first;
+		while (end < sorted.size() && sorted[end].first == shardIndex) {
+			++end;
+		}
+		const Shard& old = *shards[shardIndex];
+		auto shard = std::make_shared<Shard>();
+		shard->reserve(old.size() + end - begin);
+		auto entry = old.begin();
+		for (std::size_t change = begin; change < end;) {
+			const std::string_view term = sorted[change].second.first;
+			for (; entry != old.end() && entry->term < term; ++entry) {
+				shard->push_back(*entry);
+			}
+			int64_t frequency = 0;
+			std::string_view stored;
+			if (entry != old.end() && entry->term == term) {
+				frequency = entry->documentFrequency;
+				stored = entry->term;
+				++entry;
+				--updated->termCount;
+			}
+			for (; change < end && sorted[change].second.first == term; ++change) {
+				frequency += sorted[change].second.second;
+			}
+			if (frequency > 0) {
+				if (stored.empty()) {
+					stored = terms->GetTerm(terms->Intern(term));
+				}
+				shard->push_back({ stored, static_cast<uint32_t>(frequency), std::log(static_cast<double>(frequency)) });
+				++updated->termCount;
+			}
+		}
+		shard->insert(shard->end(), entry, old.end());
+		updated->shards[shardIndex] = std::move(shard);
+	}
+	const std::size_t deadTerms = terms->Size() + storedTermCount - updated->termCount;
+	if (deadTerms >= MIN_DEAD_TERMS && deadTerms > updated->termCount) {
+		updated->RebuildTerms();
+	}
+	updated->termsMemoryUsage = updated->terms->GetMemoryUsage();
+	return updated;
+}
+
+uint32_t TermStatistics::GetDocumentFrequency(std::string_view term)const {
+	const Entry* entry = Find(term);
+	return entry == nullptr ? 0 : entry->documentFrequency;
+}
+
+double TermStatistics::GetIdf(std::string_view term, double logDocumentCount)const {
+	const Entry* entry = Find(term);
+	return entry == nullptr ? 0.0 : logDocumentCount - entry->logDocumentFrequency;
+}
+
+std::size_t TermStatistics::GetTermCount()const {
+	return termCount;
+}
+
+std::size_t TermStatistics::GetMemoryUsage()const {
+	std::size_t bytes = shards.capacity() * sizeof(std::shared_ptr<const Shard>) + termsMemoryUsage;
+	for (const auto& shard : shards) {
+		bytes += shard->capacity() * sizeof(Entry);
+	}
+	return bytes;
+}
+
+void TermStatistics::RebuildTerms() {
+	auto rebuilt = std::make_shared<TermDictionary>();
+	for (auto& shard : shards) {
+		auto copy = std::make_shared<Shard>(*shard);
+		for (Entry& entry : *copy) {
+			entry.term = rebuilt->GetTerm(rebuilt->Intern(entry.term));
+		}
+		shard = std::move(copy);
+	}
+	terms = std::move(rebuilt);
+	storage.reset();
+	storedTermCount = 0;
+}
+
+const TermStatistics::Entry* TermStatistics::Find(std::string_view term)const {
+	const Shard& shard = *shards[GetShard(term)];
+	auto entry = std::lower_bound(shard.begin(), shard.end(), term, IsBefore);
+	if (entry == shard.end() || entry->term != term) {
+		return nullptr;
+	}
+	return &*entry;
+}
+
+std::size_t TermStatistics::GetShard(std::string_view term) {
+	return std::hash<std::string_view>()(term) & (SHARD_COUNT - 1);
+}
@@ -0,0 +1,36 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../headers/index_builder.h"
+#include "../headers/search_server.h"
+
+// Build that throws keeps the pending documents intact, so a retry indexes them as added.
+int main() {
+	SearchServer server("and"s);
+	server.AddDocument(1, "white cat", DocumentStatus::ACTUAL, { 1 });
+
+	IndexBuilder builder(server);
+	builder.Add(2, "curly dog", DocumentStatus::ACTUAL, { 7, 9 });
+	builder.Add(1, "duplicate id", DocumentStatus::ACTUAL, { 3 });
+	try {
+		builder.Build();
+		std::cerr << "Build accepted a duplicate id" << std::endl;
+		return 1;
+	}
+	catch (const std::invalid_argument&) {
+	}
+	if (builder.GetPendingCount() != 2 || server.GetDocumentCount() != 1) {
+		std::cerr << "failed Build changed the builder or the index" << std::endl;
+		return 1;
+	}
+
+	server.RemoveDocument(1);
+	builder.Build();
+	const std::vector<Document> found = server.FindTopDocuments("curly");
+	if (builder.GetPendingCount() != 0 || found.size() != 1 || found[0].id != 2 || found[0].rating != 8) {
+		std::cerr << "retried Build lost the ratings" << std::endl;
+		return 1;
+	}
+	return 0;
+}
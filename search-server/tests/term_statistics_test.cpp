@@ -0,0 +1,27 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../headers/term_statistics.h"
+
+// Terms added and dropped again leave the table no larger than the live terms need.
+int main() {
+	std::shared_ptr<const TermStatistics> statistics = std::make_shared<TermStatistics>();
+	statistics = statistics->Update({ { "kept", 2 } });
+	const std::size_t initialMemory = statistics->GetMemoryUsage();
+	for (int i = 0; i < 100000; ++i) {
+		const std::string term = "term" + std::to_string(i);
+		statistics = statistics->Update({ { term, 1 } });
+		statistics = statistics->Update({ { term, -1 } });
+	}
+	if (statistics->GetTermCount() != 1 || statistics->GetDocumentFrequency("kept") != 2 || statistics->GetDocumentFrequency("term5") != 0) {
+		std::cerr << "churn changed the frequencies" << std::endl;
+		return 1;
+	}
+	// dropped terms are kept until they reach the rebuild threshold, a few hundred kilobytes
+	if (statistics->GetMemoryUsage() > initialMemory + 512 * 1024) {
+		std::cerr << "dropped terms are still held: " << statistics->GetMemoryUsage() << " bytes" << std::endl;
+		return 1;
+	}
+	return 0;
+}
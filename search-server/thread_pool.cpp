@@ -0,0 +1,111 @@
+#include <algorithm>
+#include "headers/thread_pool.h"
+
+namespace {
+	thread_local const ThreadPool* currentPool = nullptr;
+	thread_local std::size_t currentQueue = 0;
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+	threadCount = std::max<std::size_t>(1, threadCount);
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		queues.push_back(std::make_unique<WorkerQueue>());
+	}
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		threads.emplace_back([this, i] { WorkerLoop(i); });
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard guard(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::GetDefault() {
+	static std::shared_ptr<ThreadPool> pool = std::make_shared<ThreadPool>();
+	return pool;
+}
+
+std::size_t ThreadPool::GetThreadCount()const {
+	return threads.size();
+}
+
+ThreadPool::Statistics ThreadPool::GetStatistics()const {
+	return { tasksRun.load(), steals.load(), std::chrono::nanoseconds(idleNanoseconds.load()) };
+}
+
+void ThreadPool::Push(Task task) {
+	std::size_t queueIndex = GetOwnQueue();
+	if (queueIndex == queues.size()) {
+		queueIndex = nextQueue++ % queues.size();
+	}
+	{
+		std::lock_guard guard(queues[queueIndex]->mutex);
+		queues[queueIndex]->tasks.push_back(std::move(task));
+	}
+	++pendingTasks;
+	{
+		// pairs with the predicate check in WorkerLoop so a wake-up cannot be lost
+		std::lock_guard guard(sleepMutex);
+	}
+	wakeUp.notify_one();
+}
+
+bool ThreadPool::TryRunTask() {
+	const std::size_t ownQueue = GetOwnQueue();
+	Task task;
+	if (ownQueue < queues.size()) {
+		std::lock_guard guard(queues[ownQueue]->mutex);
+		if (!queues[ownQueue]->tasks.empty()) {
+			task = std::move(queues[ownQueue]->tasks.back());
+			queues[ownQueue]->tasks.pop_back();
+		}
+	}
+	for (std::size_t i = 1; !task && i <= queues.size(); ++i) {
+		const std::size_t victimIndex = (ownQueue + i) % queues.size();
+		if (victimIndex == ownQueue) {
+			continue;
+		}
+		WorkerQueue& victim = *queues[victimIndex];
+		std::lock_guard guard(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			++steals;
+		}
+	}
+	if (!task) {
+		return false;
+	}
+	--pendingTasks;
+	task();
+	++tasksRun;
+	return true;
+}
+
+void ThreadPool::WorkerLoop(std::size_t queueIndex) {
+	currentPool = this;
+	currentQueue = queueIndex;
+	while (true) {
+		if (TryRunTask()) {
+			continue;
+		}
+		std::unique_lock lock(sleepMutex);
+		const auto idleStart = std::chrono::steady_clock::now();
+		wakeUp.wait(lock, [this] { return stopping || pendingTasks > 0; });
+		idleNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - idleStart).count();
+		if (stopping && pendingTasks == 0) {
+			return;
+		}
+	}
+}
+
+std::size_t ThreadPool::GetOwnQueue()const {
+	return currentPool == this ? currentQueue : queues.size();
+}
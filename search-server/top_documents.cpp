@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "headers/top_documents.h"
+
+TopDocuments::TopDocuments(std::size_t capacity) :capacity(capacity) {
+	heap.reserve(capacity);
+}
+
+TopDocuments::TopDocuments(std::size_t capacity, const Document& after) :TopDocuments(capacity) {
+	hasAfter = true;
+	this->after = after;
+}
+
+void TopDocuments::Push(const Document& document) {
+	if (hasAfter && !IsBetter(after, document)) {
+		return;
+	}
+	if (heap.size() < capacity) {
+		heap.push_back(document);
+		std::push_heap(heap.begin(), heap.end(), IsBetter);
+	}
+	else if (capacity > 0 && IsBetter(document, heap.front())) {
+		std::pop_heap(heap.begin(), heap.end(), IsBetter);
+		heap.back() = document;
+		std::push_heap(heap.begin(), heap.end(), IsBetter);
+	}
+}
+
+void TopDocuments::Merge(const TopDocuments& other) {
+	for (const Document& document : other.heap) {
+		Push(document);
+	}
+}
+
+double TopDocuments::GetEntryThreshold()const {
+	if (capacity == 0) {
+		return std::numeric_limits<double>::infinity();
+	}
+	if (heap.size() < capacity) {
+		return -std::numeric_limits<double>::infinity();
+	}
+	// a newcomer within EPSILON of the worst kept document may still win on rating or id
+	return heap.front().relevance - EPSILON;
+}
+
+std::vector<Document> TopDocuments::Extract() {
+	std::sort_heap(heap.begin(), heap.end(), IsBetter);
+	std::vector<Document> result = std::move(heap);
+	heap.clear();
+	return result;
+}
+
+bool TopDocuments::IsBetter(const Document& lhs, const Document& rhs) {
+	if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+		if (lhs.rating == rhs.rating) {
+			return lhs.id < rhs.id;
+		}
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
+}
@@ -0,0 +1,59 @@
+#include <algorithm>
+#include "headers/word_frequencies.h"
+
+WordFrequencies::Iterator::Iterator(const TermDictionary* dictionary, const ForwardEntry* entry, double inverseLength)
+	:dictionary(dictionary), entry(entry), inverseLength(inverseLength) {}
+
+WordFrequencies::Iterator::value_type WordFrequencies::Iterator::operator*()const {
+	return { dictionary->GetTerm(entry->termId), entry->count * inverseLength };
+}
+
+WordFrequencies::Iterator& WordFrequencies::Iterator::operator++() {
+	++entry;
+	return *this;
+}
+
+bool WordFrequencies::Iterator::operator==(const Iterator& other)const {
+	return entry == other.entry;
+}
+
+bool WordFrequencies::Iterator::operator!=(const Iterator& other)const {
+	return entry != other.entry;
+}
+
+WordFrequencies::WordFrequencies(std::shared_ptr<const void> owner, const TermDictionary& dictionary, const ForwardEntry* first, const ForwardEntry* last, double inverseLength)
+	:owner(std::move(owner)), dictionary(&dictionary), first(first), last(last), inverseLength(inverseLength) {}
+
+WordFrequencies::Iterator WordFrequencies::begin()const {
+	return { dictionary, first, inverseLength };
+}
+
+WordFrequencies::Iterator WordFrequencies::end()const {
+	return { dictionary, last, inverseLength };
+}
+
+std::size_t WordFrequencies::size()const {
+	return last - first;
+}
+
+bool WordFrequencies::empty()const {
+	return first == last;
+}
+
+double WordFrequencies::GetFrequency(std::string_view word)const {
+	if (dictionary == nullptr) {
+		return 0.0;
+	}
+	const int termId = dictionary->Find(word);
+	const ForwardEntry* entry = std::lower_bound(first, last, termId, [](const ForwardEntry& lhs, int termId) {
+		return lhs.termId < termId;
+	});
+	if (termId == TermDictionary::NOT_FOUND || entry == last || entry->termId != termId) {
+		return 0.0;
+	}
+	return entry->count * inverseLength;
+}
+
+const ForwardEntry* WordFrequencies::GetEntries()const {
+	return first;
+}